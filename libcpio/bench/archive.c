@@ -0,0 +1,200 @@
+/*
+ * Copyright 2026, agent
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bench.h"
+
+#define ALIGN4(x) (((x) + 3) & ~3ul)
+
+void archive_init(struct archive *archive)
+{
+    archive->data = NULL;
+    archive->len = 0;
+    archive->cap = 0;
+}
+
+void archive_free(struct archive *archive)
+{
+    free(archive->data);
+    archive_init(archive);
+}
+
+static char *archive_grow(struct archive *archive, unsigned long len)
+{
+    if (archive->len + len > archive->cap) {
+        unsigned long cap = archive->cap ? archive->cap : 4096;
+        while (cap < archive->len + len) {
+            cap *= 2;
+        }
+        archive->data = realloc(archive->data, cap);
+        if (archive->data == NULL) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+        archive->cap = cap;
+    }
+    char *p = archive->data + archive->len;
+    memset(p, 0, len);
+    archive->len += len;
+    return p;
+}
+
+void archive_append(struct archive *archive, const void *data, unsigned long len)
+{
+    memcpy(archive_grow(archive, len), data, len);
+}
+
+unsigned long archive_add(struct archive *archive, const char *magic, const char *name, unsigned int mode,
+                          unsigned int nlink, unsigned int ino, const void *data, unsigned long size,
+                          struct archive_entry *entry)
+{
+    unsigned long header = archive->len;
+    unsigned long namesize = strlen(name) + 1;
+    unsigned int check = 0;
+    const unsigned char *bytes = data;
+
+    if (strcmp(magic, "070702") == 0) {
+        for (unsigned long i = 0; i < size; i++) {
+            check += bytes[i];
+        }
+    }
+
+    /* Room for oversized values, which are cut off by only copying the header size. */
+    char fields[ARCHIVE_HEADER_SIZE + 32];
+    snprintf(fields, sizeof(fields), "%.6s%08x%08x%08x%08x%08x%08x%08lx%08x%08x%08x%08x%08lx%08x",
+             magic, ino, mode, 0, 0, nlink, 0x5f000000, size & 0xffffffff, 0, 0, 0, 0, namesize, check);
+    memcpy(archive_grow(archive, ARCHIVE_HEADER_SIZE), fields, ARCHIVE_HEADER_SIZE);
+    memcpy(archive_grow(archive, namesize), name, namesize);
+    unsigned long name_end = archive->len;
+    archive_grow(archive, ALIGN4(archive->len) - archive->len);
+    unsigned long data_offset = archive->len;
+    if (size > 0) {
+        memcpy(archive_grow(archive, size), data, size);
+    }
+    archive_grow(archive, ALIGN4(archive->len) - archive->len);
+
+    if (entry) {
+        entry->header = header;
+        entry->name_end = name_end;
+        entry->data = data_offset;
+        entry->size = size;
+    }
+    return header;
+}
+
+void archive_add_trailer(struct archive *archive, const char *magic)
+{
+    archive_add(archive, magic, "TRAILER!!!", 0, 1, 0, NULL, 0, NULL);
+}
+
+void archive_set_field(struct archive *archive, unsigned long header, unsigned long field, unsigned long value)
+{
+    char text[ARCHIVE_FIELD_LEN + 1];
+    snprintf(text, sizeof(text), "%08lx", value & 0xffffffff);
+    memcpy(archive->data + header + field, text, ARCHIVE_FIELD_LEN);
+}
+
+unsigned int bench_rand(unsigned int *state)
+{
+    /* xorshift32 */
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+unsigned long long bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void bench_archive_generate(struct bench_archive *bench, unsigned long count, unsigned long max_size,
+                            unsigned int link_every, unsigned int seed)
+{
+    static const char letters[] = "abcdefghijklmnopqrstuvwxyz0123456789_-.";
+    unsigned int state = seed ? seed : 1;
+    char name[160];
+
+    /* The data of all files is taken from one pattern buffer. */
+    char *pattern = malloc(max_size + 1);
+    for (unsigned long i = 0; i <= max_size; i++) {
+        pattern[i] = (char)(i * 131 + 7);
+    }
+
+    archive_init(&bench->archive);
+    bench->count = count;
+    bench->names = malloc(count * sizeof(*bench->names));
+    bench->entries = malloc(count * sizeof(*bench->entries));
+    if (bench->names == NULL || bench->entries == NULL || pattern == NULL) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+
+    for (unsigned long i = 0; i < count; i++) {
+        int len = 0;
+        unsigned int depth = bench_rand(&state) % 4;
+        for (unsigned int d = 0; d < depth; d++) {
+            len += snprintf(name + len, sizeof(name) - len, "dir%u/", bench_rand(&state) % 16);
+        }
+        /* Mostly short names with a long tail */
+        unsigned int base_len = 1 + bench_rand(&state) % (bench_rand(&state) % 4 == 0 ? 80 : 16);
+        for (unsigned int c = 0; c < base_len; c++) {
+            name[len++] = letters[bench_rand(&state) % (sizeof(letters) - 1)];
+        }
+        /* A unique suffix, so that every name is found at its own entry */
+        snprintf(name + len, sizeof(name) - len, ".%lx", i);
+
+        /* Logarithmic spread of sizes, i.e. many small files and some large ones */
+        unsigned long size = 0;
+        if (max_size > 0) {
+            unsigned int bits = 0;
+            while ((1ul << bits) <= max_size) {
+                bits++;
+            }
+            unsigned long limit = 1ul << (bench_rand(&state) % (bits + 1));
+            size = bench_rand(&state) % limit;
+            if (size > max_size) {
+                size = max_size;
+            }
+        }
+
+        /* The last two files of each group of link_every files are a link pair, data first */
+        unsigned int nlink = 1;
+        unsigned long ino = i + 1;
+        if (link_every >= 2 && i % link_every == link_every - 2) {
+            nlink = 2;
+            size = size ? size : 1;
+        } else if (link_every >= 2 && i % link_every == link_every - 1) {
+            nlink = 2;
+            ino = i;
+            size = 0;
+        }
+
+        archive_add(&bench->archive, "070701", name, ARCHIVE_REG, nlink, ino, pattern, size, &bench->entries[i]);
+    }
+    archive_add_trailer(&bench->archive, "070701");
+
+    /* The names are only stable once the archive stopped growing */
+    for (unsigned long i = 0; i < count; i++) {
+        bench->names[i] = bench->archive.data + bench->entries[i].header + ARCHIVE_HEADER_SIZE;
+    }
+    free(pattern);
+}
+
+void bench_archive_free(struct bench_archive *bench)
+{
+    archive_free(&bench->archive);
+    free(bench->names);
+    free(bench->entries);
+}
@@ -0,0 +1,351 @@
+/*
+ * Copyright 2026, agent
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/*
+ * Host benchmark of the libcpio lookup paths over synthetic archives. Every
+ * operation is repeated until it ran for a minimum time, and reported as the
+ * time per operation and the archive bytes covered per second.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <cpio/cpio.h>
+
+#include "bench.h"
+
+#define BENCH_MIN_NS 200000000ull
+#define BENCH_TARGETS 4096
+#define BENCH_MAX_THREADS 64
+
+struct bench_ctx {
+    struct bench_archive *bench;
+    const char *archive;
+    unsigned long len;
+    /* Random entry numbers that lookups are made for */
+    unsigned long targets[BENCH_TARGETS];
+    cpio_index_t index;
+    void *index_buf;
+    unsigned long index_len;
+    void *scratch;
+    unsigned long scratch_len;
+    unsigned int num_tasks;
+    cpio_paths_t paths;
+    void *paths_buf;
+    unsigned long paths_len;
+    void *links_buf;
+    unsigned long links_len;
+};
+
+/* Consumes results, so that the compiler cannot drop the operations. */
+static volatile unsigned long bench_sink;
+
+/* Runs an operation 'reps' times, returning the archive bytes covered. */
+typedef unsigned long (*bench_fn)(struct bench_ctx *ctx, unsigned long reps);
+
+static unsigned long bench_info(struct bench_ctx *ctx, unsigned long reps)
+{
+    struct cpio_info info;
+    for (unsigned long i = 0; i < reps; i++) {
+        cpio_info(ctx->archive, ctx->len, &info);
+        bench_sink += info.file_count;
+    }
+    return reps * ctx->len;
+}
+
+static unsigned long bench_iter(struct bench_ctx *ctx, unsigned long reps)
+{
+    cpio_iter_t iter;
+    struct cpio_entry entry;
+
+    cpio_iter_init(&iter, ctx->archive, ctx->len);
+    if (ctx->links_buf != NULL && cpio_iter_set_links(&iter, ctx->links_buf, ctx->links_len)) {
+        fprintf(stderr, "cpio_iter_set_links failed\n");
+        exit(1);
+    }
+    for (unsigned long i = 0; i < reps; i++) {
+        if (cpio_iter_next(&iter, &entry) != 0) {
+            cpio_iter_reset(&iter);
+            cpio_iter_next(&iter, &entry);
+        }
+        bench_sink += entry.size;
+    }
+    /* Every entry is visited once per pass. */
+    return (unsigned long)((double) reps * ctx->len / ctx->bench->count);
+}
+
+/* Bytes that a linear lookup of the given entry walks over. */
+static unsigned long bench_scanned(struct bench_ctx *ctx, unsigned long n)
+{
+    return ctx->bench->entries[n].data + ctx->bench->entries[n].size;
+}
+
+static unsigned long bench_get_file(struct bench_ctx *ctx, unsigned long reps)
+{
+    unsigned long bytes = 0;
+    unsigned long size;
+    for (unsigned long i = 0; i < reps; i++) {
+        unsigned long n = ctx->targets[i % BENCH_TARGETS];
+        bench_sink += (unsigned long) cpio_get_file(ctx->archive, ctx->len, ctx->bench->names[n], &size);
+        bytes += bench_scanned(ctx, n);
+    }
+    return bytes;
+}
+
+static unsigned long bench_get_entry(struct bench_ctx *ctx, unsigned long reps)
+{
+    unsigned long bytes = 0;
+    unsigned long size;
+    for (unsigned long i = 0; i < reps; i++) {
+        unsigned long n = ctx->targets[i % BENCH_TARGETS];
+        bench_sink += (unsigned long) cpio_get_entry(ctx->archive, ctx->len, n, NULL, &size);
+        bytes += bench_scanned(ctx, n);
+    }
+    return bytes;
+}
+
+static unsigned long bench_index_init(struct bench_ctx *ctx, unsigned long reps)
+{
+    for (unsigned long i = 0; i < reps; i++) {
+        if (cpio_index_init(&ctx->index, ctx->archive, ctx->len, ctx->index_buf, ctx->index_len)) {
+            fprintf(stderr, "cpio_index_init failed\n");
+            exit(1);
+        }
+    }
+    return reps * ctx->len;
+}
+
+struct bench_thread {
+    pthread_t thread;
+    cpio_task_fn task;
+    void *arg;
+    unsigned int n;
+};
+
+static void *bench_thread_main(void *arg)
+{
+    struct bench_thread *t = arg;
+    t->task(t->arg, t->n);
+    return NULL;
+}
+
+/* Runs the tasks on one thread each, the first one on the calling thread. */
+static void bench_run_tasks(void *cookie, cpio_task_fn task, void *arg, unsigned int num_tasks)
+{
+    struct bench_thread threads[BENCH_MAX_THREADS];
+    (void) cookie;
+
+    for (unsigned int i = 1; i < num_tasks; i++) {
+        threads[i].task = task;
+        threads[i].arg = arg;
+        threads[i].n = i;
+        if (pthread_create(&threads[i].thread, NULL, bench_thread_main, &threads[i])) {
+            fprintf(stderr, "pthread_create failed\n");
+            exit(1);
+        }
+    }
+    task(arg, 0);
+    for (unsigned int i = 1; i < num_tasks; i++) {
+        pthread_join(threads[i].thread, NULL);
+    }
+}
+
+static unsigned long bench_index_init_parallel(struct bench_ctx *ctx, unsigned long reps)
+{
+    for (unsigned long i = 0; i < reps; i++) {
+        if (cpio_index_init_parallel(&ctx->index, ctx->archive, ctx->len, ctx->index_buf, ctx->index_len,
+                                     ctx->scratch, ctx->scratch_len, ctx->num_tasks, bench_run_tasks, NULL)) {
+            fprintf(stderr, "cpio_index_init_parallel failed\n");
+            exit(1);
+        }
+    }
+    return reps * ctx->len;
+}
+
+static unsigned long bench_index_get_file(struct bench_ctx *ctx, unsigned long reps)
+{
+    unsigned long bytes = 0;
+    unsigned long size = 0;
+    for (unsigned long i = 0; i < reps; i++) {
+        unsigned long n = ctx->targets[i % BENCH_TARGETS];
+        bench_sink += (unsigned long) cpio_index_get_file(&ctx->index, ctx->bench->names[n], &size);
+        bytes += size;
+    }
+    return bytes;
+}
+
+static unsigned long bench_index_get_entry(struct bench_ctx *ctx, unsigned long reps)
+{
+    unsigned long bytes = 0;
+    unsigned long size = 0;
+    for (unsigned long i = 0; i < reps; i++) {
+        unsigned long n = ctx->targets[i % BENCH_TARGETS];
+        bench_sink += (unsigned long) cpio_index_get_entry(&ctx->index, n, NULL, &size);
+        bytes += size;
+    }
+    return bytes;
+}
+
+static unsigned long bench_paths_init(struct bench_ctx *ctx, unsigned long reps)
+{
+    for (unsigned long i = 0; i < reps; i++) {
+        if (cpio_paths_init(&ctx->paths, &ctx->index, ctx->paths_buf, ctx->paths_len)) {
+            fprintf(stderr, "cpio_paths_init failed\n");
+            exit(1);
+        }
+    }
+    return reps * ctx->len;
+}
+
+/* Run an operation with doubling repetitions until it took long enough. */
+static void bench_measure(struct bench_ctx *ctx, const char *name, bench_fn fn)
+{
+    unsigned long reps = 1;
+    unsigned long long elapsed;
+    unsigned long bytes;
+
+    while (1) {
+        unsigned long long start = bench_now();
+        bytes = fn(ctx, reps);
+        elapsed = bench_now() - start;
+        if (elapsed >= BENCH_MIN_NS) {
+            break;
+        }
+        reps *= 2;
+    }
+    printf("%10lu  %-26s %14.1f %12.1f\n", ctx->bench->count, name,
+           (double) elapsed / reps, (double) bytes / (1 << 20) / (elapsed / 1e9));
+}
+
+static void bench_archive_run(unsigned long count, unsigned long max_size, unsigned int link_every,
+                              unsigned int num_tasks)
+{
+    struct bench_archive bench;
+    struct bench_ctx *ctx = calloc(1, sizeof(*ctx));
+    char name[64];
+
+    bench_archive_generate(&bench, count, max_size, link_every, 1);
+    ctx->bench = &bench;
+    ctx->archive = bench.archive.data;
+    ctx->len = bench.archive.len;
+    unsigned int state = 7;
+    for (int i = 0; i < BENCH_TARGETS; i++) {
+        ctx->targets[i] = bench_rand(&state) % count;
+    }
+
+    ctx->index_len = cpio_index_buf_size(count);
+    ctx->index_buf = malloc(ctx->index_len);
+    ctx->num_tasks = num_tasks;
+    ctx->scratch_len = cpio_index_scratch_size(ctx->len, num_tasks);
+    ctx->scratch = malloc(ctx->scratch_len);
+    ctx->links_len = cpio_iter_links_buf_size(count);
+    if (ctx->index_buf == NULL || ctx->scratch == NULL) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+
+    bench_measure(ctx, "cpio_info", bench_info);
+    bench_measure(ctx, "cpio_iter_next", bench_iter);
+    ctx->links_buf = malloc(ctx->links_len);
+    bench_measure(ctx, "cpio_iter_next/links", bench_iter);
+    free(ctx->links_buf);
+    ctx->links_buf = NULL;
+    bench_measure(ctx, "cpio_get_file", bench_get_file);
+    bench_measure(ctx, "cpio_get_entry", bench_get_entry);
+    bench_measure(ctx, "cpio_index_init", bench_index_init);
+    snprintf(name, sizeof(name), "cpio_index_init_parallel/%u", num_tasks);
+    bench_measure(ctx, name, bench_index_init_parallel);
+    bench_measure(ctx, "cpio_index_get_file", bench_index_get_file);
+    bench_measure(ctx, "cpio_index_get_entry", bench_index_get_entry);
+
+    ctx->paths_len = cpio_paths_buf_size(&ctx->index);
+    ctx->paths_buf = malloc(ctx->paths_len);
+    bench_measure(ctx, "cpio_paths_init", bench_paths_init);
+
+    free(ctx->paths_buf);
+    free(ctx->scratch);
+    free(ctx->index_buf);
+    free(ctx);
+    bench_archive_free(&bench);
+}
+
+int bench_main(int argc, char **argv)
+{
+    static const unsigned long default_counts[] = { 1000, 10000, 100000, 1000000 };
+    unsigned long max_size = 1024;
+    unsigned int link_every = 0;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned int num_tasks = cpus > 0 ? cpus : 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "l:s:t:")) != -1) {
+        switch (opt) {
+        case 'l':
+            link_every = strtoul(optarg, NULL, 0);
+            break;
+        case 's':
+            max_size = strtoul(optarg, NULL, 0);
+            break;
+        case 't':
+            num_tasks = strtoul(optarg, NULL, 0);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-l link_every] [-s max_file_size] [-t tasks] [file_count...]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (num_tasks == 0) {
+        num_tasks = 1;
+    } else if (num_tasks > BENCH_MAX_THREADS) {
+        num_tasks = BENCH_MAX_THREADS;
+    }
+
+    printf("%10s  %-26s %14s %12s\n", "files", "operation", "ns/op", "MiB/s");
+    if (optind == argc) {
+        for (unsigned long i = 0; i < sizeof(default_counts) / sizeof(default_counts[0]); i++) {
+            bench_archive_run(default_counts[i], max_size, link_every, num_tasks);
+        }
+    }
+    for (int i = optind; i < argc; i++) {
+        unsigned long count = strtoul(argv[i], NULL, 0);
+        if (count == 0) {
+            fprintf(stderr, "invalid file count: %s\n", argv[i]);
+            return 1;
+        }
+        bench_archive_run(count, max_size, link_every, num_tasks);
+    }
+    return 0;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s bench [-l link_every] [-s max_file_size] [-t tasks] [file_count...]\n", prog);
+    fprintf(stderr, "       %s corpus [-n mutations] [-s seed] [-v]\n", prog);
+    fprintf(stderr, "       %s hex-bench\n", prog);
+    fprintf(stderr, "       %s hex-check [-q]\n", prog);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (strcmp(argv[1], "bench") == 0) {
+        return bench_main(argc - 1, argv + 1);
+    } else if (strcmp(argv[1], "corpus") == 0) {
+        return corpus_main(argc - 1, argv + 1);
+    } else if (strcmp(argv[1], "hex-bench") == 0) {
+        return hex_bench_main(argc - 1, argv + 1);
+    } else if (strcmp(argv[1], "hex-check") == 0) {
+        return hex_check_main(argc - 1, argv + 1);
+    }
+    usage(argv[0]);
+    return 1;
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2026, agent
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+/* Offsets of the fields of a newc header, see struct cpio_header. */
+#define ARCHIVE_HEADER_SIZE 110
+#define ARCHIVE_FIELD_LEN 8
+#define ARCHIVE_FIELD(i) (6 + (i) * ARCHIVE_FIELD_LEN)
+#define ARCHIVE_INO ARCHIVE_FIELD(0)
+#define ARCHIVE_MODE ARCHIVE_FIELD(1)
+#define ARCHIVE_NLINK ARCHIVE_FIELD(4)
+#define ARCHIVE_MTIME ARCHIVE_FIELD(5)
+#define ARCHIVE_FILESIZE ARCHIVE_FIELD(6)
+#define ARCHIVE_NAMESIZE ARCHIVE_FIELD(11)
+#define ARCHIVE_CHECK ARCHIVE_FIELD(12)
+
+#define ARCHIVE_REG 0100644
+#define ARCHIVE_DIR 0040755
+
+/* A growable archive, written without libcpio so that it can check the readers. */
+struct archive {
+    char *data;
+    unsigned long len;
+    unsigned long cap;
+};
+
+/* Where an entry ended up in an archive. */
+struct archive_entry {
+    unsigned long header;
+    unsigned long name_end;
+    unsigned long data;
+    unsigned long size;
+};
+
+void archive_init(struct archive *archive);
+void archive_free(struct archive *archive);
+void archive_append(struct archive *archive, const void *data, unsigned long len);
+
+/*
+ * Append an entry with the given magic, "070701" or "070702". The checksum of
+ * "070702" entries is computed from the data. Returns the offset of the header.
+ */
+unsigned long archive_add(struct archive *archive, const char *magic, const char *name, unsigned int mode,
+                          unsigned int nlink, unsigned int ino, const void *data, unsigned long size,
+                          struct archive_entry *entry);
+void archive_add_trailer(struct archive *archive, const char *magic);
+
+/* Overwrite a field of the header at the given offset. */
+void archive_set_field(struct archive *archive, unsigned long header, unsigned long field, unsigned long value);
+
+/* A synthetic archive for benchmarking, with the name and layout of each entry. */
+struct bench_archive {
+    struct archive archive;
+    unsigned long count;
+    char **names;
+    struct archive_entry *entries;
+};
+
+/*
+ * Generate 'count' regular files with names of 1 to about 100 characters in
+ * up to three levels of directories, and sizes spread logarithmically over
+ * 0 to max_size bytes. If link_every is at least 2, the last file of every
+ * link_every files is a hard link to the file before it.
+ */
+void bench_archive_generate(struct bench_archive *bench, unsigned long count, unsigned long max_size,
+                            unsigned int link_every, unsigned int seed);
+void bench_archive_free(struct bench_archive *bench);
+
+/* Monotonic time in nanoseconds. */
+unsigned long long bench_now(void);
+
+/* Small deterministic random number generator. */
+unsigned int bench_rand(unsigned int *state);
+
+int bench_main(int argc, char **argv);
+int corpus_main(int argc, char **argv);
+int hex_check_main(int argc, char **argv);
+int hex_bench_main(int argc, char **argv);
@@ -0,0 +1,925 @@
+/*
+ * Copyright 2026, agent
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/*
+ * Regression corpus of well formed, truncated and malformed archives. Every
+ * archive is copied into a buffer of its exact size, so that out of bounds
+ * reads are caught when built with -fsanitize=address, and run through every
+ * entry point of libcpio. The entry points are checked against each other and
+ * against the outcome expected for the archive.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <cpio/cpio.h>
+
+#include "bench.h"
+
+/* Outcome that is not known up front, e.g. for randomly mutated archives. */
+#define CORPUS_ANY (-2)
+#define CORPUS_MAX_TASKS 5
+#define CORPUS_MAX_FAILURES 50
+#define CORPUS_LZ4_SLOT 4096
+
+struct corpus_expect {
+    /* Number of entries, or -1 if the archive is malformed */
+    int count;
+    /* Number of entries returned by the iterator before the error */
+    int yielded;
+    /* 1 if the checksum of an entry does not match, 0 if all do */
+    int bad_check;
+    /* 1 if all LZ4 members decompress, 0 if one does not */
+    int lz4_ok;
+};
+
+static const struct corpus_expect expect_malformed = { -1, CORPUS_ANY, CORPUS_ANY, CORPUS_ANY };
+static const struct corpus_expect expect_any = { CORPUS_ANY, CORPUS_ANY, CORPUS_ANY, CORPUS_ANY };
+
+static struct corpus_expect expect_count(int count)
+{
+    struct corpus_expect expect = { count, CORPUS_ANY, 0, 1 };
+    return expect;
+}
+
+struct corpus_entry {
+    const char *name;
+    const char *data;
+    unsigned long size;
+};
+
+static const char *corpus_case;
+static unsigned long corpus_cases;
+static unsigned long corpus_failures;
+static int corpus_verbose;
+
+static void corpus_fail(int line, const char *what)
+{
+    if (corpus_failures++ < CORPUS_MAX_FAILURES) {
+        fprintf(stderr, "FAIL %s: %s:%d: %s\n", corpus_case, __FILE__, line, what);
+    }
+}
+
+#define CHECK(cond) do { if (!(cond)) corpus_fail(__LINE__, #cond); } while (0)
+
+/* Non-zero if [p, p + size) lies within the archive. */
+static int corpus_within(const char *buf, unsigned long len, const void *p, unsigned long size)
+{
+    uintptr_t start = (uintptr_t) buf;
+    uintptr_t q = (uintptr_t) p;
+    return q >= start && q <= start + len && size <= start + len - q;
+}
+
+/* Non-zero if the name lies within the archive, including its terminator. */
+static int corpus_name_within(const char *buf, unsigned long len, const char *name)
+{
+    return corpus_within(buf, len, name, 0) && (uintptr_t) name < (uintptr_t) buf + len &&
+           memchr(name, 0, buf + len - name) != NULL;
+}
+
+/* Data of an entry, which is only dereferenced for non-empty files. */
+static int corpus_data_within(const char *buf, unsigned long len, const void *data, unsigned long size)
+{
+    return size == 0 || corpus_within(buf, len, data, size);
+}
+
+/* The byte sum of "070702" archives, computed independently of cpio_checksum. */
+static unsigned int corpus_sum(const void *data, unsigned long size)
+{
+    const unsigned char *p = data;
+    unsigned int sum = 0;
+    for (unsigned long i = 0; i < size; i++) {
+        sum += p[i];
+    }
+    return sum;
+}
+
+/* Position of the first entry with the given name, as found by name lookups. */
+static int corpus_first(const struct corpus_entry *entries, int n, const char *name)
+{
+    for (int i = 0; i < n; i++) {
+        if (strcmp(entries[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* Walk the archive with the iterator, returning its final status. */
+static int corpus_iterate(const char *buf, unsigned long len, struct corpus_entry *entries,
+                          unsigned long max_entries, int *n)
+{
+    cpio_iter_t iter;
+    struct cpio_entry entry;
+    int status;
+
+    *n = 0;
+    cpio_iter_init(&iter, buf, len);
+    while ((status = cpio_iter_next(&iter, &entry)) == 0) {
+        CHECK((unsigned long) *n < max_entries);
+        if ((unsigned long) *n >= max_entries) {
+            return -1;
+        }
+        CHECK(corpus_name_within(buf, len, entry.name));
+        CHECK(corpus_data_within(buf, len, entry.data, entry.size));
+        entries[*n].name = entry.name;
+        entries[*n].data = entry.data;
+        entries[*n].size = entry.size;
+        (*n)++;
+    }
+    CHECK(status == 1 || status == -1);
+    CHECK(iter.status == status);
+    /* The end of the archive is sticky. */
+    CHECK(cpio_iter_next(&iter, &entry) == status);
+
+    /* Rewinding and skipping entries without resolving them visits the same entries. */
+    int skipped = 0;
+    cpio_iter_reset(&iter);
+    while (cpio_iter_next(&iter, NULL) == 0) {
+        skipped++;
+    }
+    CHECK(skipped == *n);
+    CHECK(iter.status == status);
+    return status;
+}
+
+/*
+ * Iterators with a link table resolve hard links like the plain iterator,
+ * whether the table holds every holder or overflows after the first one.
+ */
+static void corpus_check_links(const char *buf, unsigned long len, const struct corpus_entry *entries, int n,
+                               int status)
+{
+    unsigned long sizes[] = { cpio_iter_links_buf_size(n), sizeof(const struct cpio_header *) };
+    void *links = malloc(sizes[0]);
+    cpio_iter_t iter;
+    struct cpio_entry entry;
+
+    cpio_iter_init(&iter, buf, len);
+    CHECK(cpio_iter_set_links(&iter, NULL, sizes[0]) != 0);
+    CHECK(cpio_iter_set_links(&iter, links, sizeof(const struct cpio_header *) - 1) != 0);
+
+    for (unsigned int s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        cpio_iter_init(&iter, buf, len);
+        CHECK(cpio_iter_set_links(&iter, links, sizes[s]) == 0);
+        /* The second pass after a reset finds the holders of the first pass in the table. */
+        for (int pass = 0; pass < 2; pass++) {
+            int i = 0;
+            int result;
+            while ((result = cpio_iter_next(&iter, &entry)) == 0 && i < n) {
+                CHECK(entry.name == entries[i].name);
+                CHECK(entry.data == entries[i].data);
+                CHECK(entry.size == entries[i].size);
+                i++;
+            }
+            CHECK(i == n);
+            CHECK(result == status);
+            cpio_iter_reset(&iter);
+        }
+    }
+    free(links);
+}
+
+/* cpio_info, cpio_ls, cpio_get_entry and cpio_get_file against the iterator. */
+static void corpus_check_linear(const char *buf, unsigned long len, const struct corpus_entry *entries, int n,
+                                int status)
+{
+    struct cpio_info info;
+    unsigned int max_path_sz = 0;
+
+    for (int i = 0; i < n; i++) {
+        if (strlen(entries[i].name) > max_path_sz) {
+            max_path_sz = strlen(entries[i].name);
+        }
+    }
+
+    int error = cpio_info(buf, len, &info);
+    CHECK((error == 0) == (status == 1));
+    if (error == 0) {
+        CHECK(info.file_count == (unsigned int) n);
+        CHECK(info.max_path_sz == max_path_sz);
+    }
+    CHECK(cpio_info(buf, len, NULL) != 0);
+
+    /* One more slot than entries, which must be left untouched. */
+    char **names = malloc((n + 1) * sizeof(*names));
+    for (int i = 0; i <= n; i++) {
+        names[i] = malloc(max_path_sz + 1);
+        strcpy(names[i], "");
+        names[i][0] = 1;
+    }
+    cpio_ls(buf, len, names, n + 1);
+    for (int i = 0; i < n; i++) {
+        CHECK(strcmp(names[i], entries[i].name) == 0);
+    }
+    CHECK(names[n][0] == 1);
+    for (int i = 0; i <= n; i++) {
+        free(names[i]);
+    }
+    free(names);
+
+    for (int i = 0; i < n; i++) {
+        const char *name = NULL;
+        unsigned long size = 0;
+        const void *data = cpio_get_entry(buf, len, i, &name, &size);
+        CHECK(data == entries[i].data);
+        CHECK(name == entries[i].name);
+        CHECK(size == entries[i].size);
+
+        int first = corpus_first(entries, n, entries[i].name);
+        size = 0;
+        data = cpio_get_file(buf, len, entries[i].name, &size);
+        CHECK(data == entries[first].data);
+        CHECK(size == entries[first].size);
+    }
+    CHECK(cpio_get_entry(buf, len, n, NULL, NULL) == NULL);
+    CHECK(cpio_get_entry(buf, len, -1, NULL, NULL) == NULL);
+    CHECK(cpio_get_file(buf, len, "\x7fmissing", NULL) == NULL);
+}
+
+/* Check an index against the entries found by the iterator. */
+static void corpus_check_index_entries(const char *buf, unsigned long len, cpio_index_t *index,
+                                       const struct corpus_entry *entries, int n)
+{
+    CHECK(index->file_count == (unsigned int) n);
+    if (index->file_count != (unsigned int) n) {
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        const char *name = NULL;
+        unsigned long size = 0;
+        CHECK(index->entries[i].name == entries[i].name);
+        CHECK(corpus_within(buf, len, index->entries[i].header, ARCHIVE_HEADER_SIZE));
+        const void *data = cpio_index_get_entry(index, i, &name, &size);
+        CHECK(data == entries[i].data);
+        CHECK(name == entries[i].name);
+        CHECK(size == entries[i].size);
+
+        int first = corpus_first(entries, n, entries[i].name);
+        size = 0;
+        data = cpio_index_get_file(index, entries[i].name, &size);
+        CHECK(data == entries[first].data);
+        CHECK(size == entries[first].size);
+    }
+    CHECK(cpio_index_get_entry(index, n, NULL, NULL) == NULL);
+    CHECK(cpio_index_get_entry(index, -1, NULL, NULL) == NULL);
+    CHECK(cpio_index_get_file(index, "\x7fmissing", NULL) == NULL);
+}
+
+/* Runs the tasks in reverse order, as they must not depend on each other. */
+static void corpus_run_tasks(void *cookie, cpio_task_fn task, void *arg, unsigned int num_tasks)
+{
+    (void) cookie;
+    for (unsigned int i = num_tasks; i > 0; i--) {
+        task(arg, i - 1);
+    }
+}
+
+/* cpio_index_init_parallel must build exactly the same index as cpio_index_init. */
+static void corpus_check_parallel(const char *buf, unsigned long len, const cpio_index_t *serial, int serial_error,
+                                  int n)
+{
+    unsigned int count = serial_error ? 0 : serial->file_count;
+    /* Room for more entries than found, so that malformed archives fail as such. */
+    unsigned long index_len = cpio_index_buf_size(n + 1);
+    void *index_buf = malloc(index_len ? index_len : 1);
+
+    for (unsigned int tasks = 1; tasks <= CORPUS_MAX_TASKS; tasks++) {
+        cpio_index_t index;
+        unsigned long scratch_len = cpio_index_scratch_size(len, tasks);
+        void *scratch = malloc(scratch_len);
+
+        CHECK(cpio_index_init_parallel(&index, buf, len, index_buf, index_len, scratch, scratch_len - 1,
+                                       tasks, corpus_run_tasks, NULL) != 0);
+        if (serial_error == 0) {
+            CHECK(cpio_index_init_parallel(&index, buf, len, index_buf, cpio_index_buf_size(count) - 1,
+                                           scratch, scratch_len, tasks, corpus_run_tasks, NULL) != 0);
+        }
+        int error = cpio_index_init_parallel(&index, buf, len, index_buf, index_len, scratch, scratch_len,
+                                             tasks, corpus_run_tasks, NULL);
+        CHECK((error != 0) == (serial_error != 0));
+        if (error == 0 && serial_error == 0) {
+            CHECK(index.file_count == serial->file_count);
+            CHECK(index.max_path_sz == serial->max_path_sz);
+            for (unsigned int i = 0; i < count && index.file_count == count; i++) {
+                const cpio_index_entry_t *a = &index.entries[i];
+                const cpio_index_entry_t *b = &serial->entries[i];
+                CHECK(a->header == b->header && a->name == b->name && a->data == b->data &&
+                      a->size == b->size && a->hash == b->hash && a->check == b->check &&
+                      a->check_state == b->check_state);
+            }
+        }
+        free(scratch);
+    }
+    free(index_buf);
+}
+
+/* Checksum verification, with the byte sums computed independently. */
+static int corpus_check_verify(const char *buf, unsigned long len, const struct corpus_entry *entries, int n)
+{
+    cpio_index_t eager;
+    cpio_index_t lazy;
+    unsigned long index_len = cpio_index_buf_size(n);
+    void *eager_buf = malloc(index_len);
+    void *lazy_buf = malloc(index_len);
+    int bad = 0;
+
+    if (cpio_index_init(&eager, buf, len, eager_buf, index_len) ||
+        cpio_index_init(&lazy, buf, len, lazy_buf, index_len)) {
+        CHECK(0);
+        free(eager_buf);
+        free(lazy_buf);
+        return CORPUS_ANY;
+    }
+
+    int error = cpio_index_set_verify(&eager, CPIO_VERIFY_EAGER);
+    CHECK(cpio_index_set_verify(&lazy, CPIO_VERIFY_LAZY) == 0);
+    for (int i = 0; i < n; i++) {
+        const cpio_index_entry_t *entry = &eager.entries[i];
+        unsigned long name_end = entries[i].name + strlen(entries[i].name) + 1 - buf;
+        const char *own_data = buf + ((name_end + 3) & ~3ul);
+        int entry_bad = 0;
+
+        /* Resolved hard links take the data and the checksum of the entry holding them. */
+        if (entries[i].data == own_data) {
+            int has_check = memcmp(entry->header, CPIO_HEADER_MAGIC_CRC, 6) == 0;
+            CHECK((entry->check_state != CPIO_CHECK_NONE) == has_check);
+        }
+        if (entry->check_state != CPIO_CHECK_NONE) {
+            entry_bad = corpus_sum(entries[i].data, entries[i].size) != entry->check;
+            CHECK(entry->check_state == (entry_bad ? CPIO_CHECK_BAD : CPIO_CHECK_OK));
+        }
+        bad |= entry_bad;
+
+        const void *data = cpio_index_get_entry(&lazy, i, NULL, NULL);
+        CHECK(entry_bad ? data == NULL : data == entries[i].data);
+        CHECK((cpio_index_get_entry(&eager, i, NULL, NULL) == NULL) == entry_bad);
+    }
+    CHECK((error != 0) == bad);
+
+    free(eager_buf);
+    free(lazy_buf);
+    return bad;
+}
+
+struct corpus_paths_cookie {
+    const char *buf;
+    unsigned long len;
+    const cpio_index_t *index;
+    unsigned long matches;
+};
+
+static int corpus_path_fn(void *cookie, const char *name, unsigned long name_len, const cpio_index_entry_t *entry)
+{
+    struct corpus_paths_cookie *c = cookie;
+    CHECK(corpus_within(c->buf, c->len, name, name_len));
+    if (entry) {
+        CHECK(entry >= c->index->entries && entry < c->index->entries + c->index->file_count);
+        CHECK(entry->name == name && name[name_len] == 0);
+    }
+    c->matches++;
+    return 0;
+}
+
+static void corpus_check_paths(const char *buf, unsigned long len, cpio_index_t *index)
+{
+    cpio_paths_t paths;
+    unsigned long paths_len = cpio_paths_buf_size(index);
+    void *paths_buf = malloc(paths_len ? paths_len : 1);
+    struct corpus_paths_cookie cookie = { buf, len, index, 0 };
+    unsigned int first;
+    unsigned int count;
+
+    CHECK(cpio_paths_init(&paths, index, paths_buf, paths_len) == 0);
+    for (unsigned int i = 0; i < index->file_count; i++) {
+        const cpio_index_entry_t *entry = cpio_paths_get(&paths, i);
+        CHECK(entry != NULL);
+        if (i > 0 && entry) {
+            const unsigned char *a = (const unsigned char *) cpio_paths_get(&paths, i - 1)->name;
+            const unsigned char *b = (const unsigned char *) entry->name;
+            while (*a && *a == *b) {
+                a++;
+                b++;
+            }
+            CHECK(*a <= *b);
+        }
+    }
+    CHECK(cpio_paths_get(&paths, index->file_count) == NULL);
+
+    cpio_paths_prefix(&paths, "d", &first, &count);
+    CHECK(first + count <= index->file_count);
+    for (unsigned int i = first; i < first + count && i < index->file_count; i++) {
+        CHECK(cpio_paths_get(&paths, i)->name[0] == 'd');
+    }
+
+    CHECK(cpio_paths_list_dir(&paths, "", corpus_path_fn, &cookie) == 0);
+    CHECK(cpio_paths_list_dir(&paths, "dir/", corpus_path_fn, &cookie) == 0);
+    CHECK(cpio_paths_glob(&paths, "*", corpus_path_fn, &cookie) == 0);
+    CHECK(cpio_paths_glob(&paths, "d?r/*", corpus_path_fn, &cookie) == 0);
+    free(paths_buf);
+}
+
+/* Decompress every LZ4 member, returning whether all of them decoded. */
+static int corpus_check_lz4(const struct corpus_entry *entries, int n)
+{
+    static char cache_buf[CPIO_LZ4_CACHE_SLOTS * CORPUS_LZ4_SLOT];
+    cpio_lz4_cache_t cache;
+    int ok = 1;
+
+    CHECK(cpio_lz4_cache_init(&cache, cache_buf, sizeof(cache_buf)) == 0);
+    for (int i = 0; i < n; i++) {
+        if (!cpio_lz4_is_compressed(entries[i].name)) {
+            continue;
+        }
+        long out_size = cpio_lz4_size(entries[i].data, entries[i].size);
+        CHECK(out_size >= -1);
+        if (out_size < 0 || out_size > CORPUS_LZ4_SLOT) {
+            ok = 0;
+            continue;
+        }
+
+        /* Exact size output buffers, so that overruns are caught. */
+        char *out = malloc(out_size ? out_size : 1);
+        long decoded = cpio_lz4_decompress(entries[i].data, entries[i].size, out, out_size);
+        CHECK(decoded == -1 || decoded == out_size);
+        if (out_size > 0) {
+            CHECK(cpio_lz4_decompress(entries[i].data, entries[i].size, out, out_size - 1) == -1);
+        }
+
+        unsigned long cached_size = 0;
+        const void *cached = cpio_lz4_cache_get(&cache, entries[i].data, entries[i].size, &cached_size);
+        CHECK((cached == NULL) == (decoded < 0));
+        if (cached && decoded >= 0) {
+            CHECK(cached_size == (unsigned long) decoded && memcmp(cached, out, decoded) == 0);
+            CHECK(cpio_lz4_cache_get(&cache, entries[i].data, entries[i].size, NULL) == cached);
+        }
+        if (decoded < 0) {
+            ok = 0;
+        }
+        free(out);
+    }
+    return ok;
+}
+
+/* Run an archive through every entry point. */
+static void corpus_run(const char *name, const char *src, unsigned long len, struct corpus_expect expect)
+{
+    /* Every entry takes up at least a header and a name byte. */
+    unsigned long max_entries = len / (ARCHIVE_HEADER_SIZE + 1) + 1;
+    struct corpus_entry *entries = malloc(max_entries * sizeof(*entries));
+    char *buf = malloc(len ? len : 1);
+    int n;
+
+    corpus_case = name;
+    corpus_cases++;
+    if (corpus_verbose) {
+        printf("%s (%lu bytes)\n", name, len);
+    }
+    memcpy(buf, src, len);
+
+    int status = corpus_iterate(buf, len, entries, max_entries, &n);
+    if (expect.count == -1) {
+        CHECK(status == -1);
+    } else if (expect.count != CORPUS_ANY) {
+        CHECK(status == 1);
+        CHECK(n == expect.count);
+    }
+    if (expect.yielded != CORPUS_ANY) {
+        CHECK(n == expect.yielded);
+    }
+
+    corpus_check_links(buf, len, entries, n, status);
+    corpus_check_linear(buf, len, entries, n, status);
+
+    cpio_index_t index;
+    unsigned long index_len = cpio_index_buf_size(n);
+    void *index_buf = malloc(index_len);
+    int error = cpio_index_init(&index, buf, len, index_buf, index_len);
+    CHECK((error == 0) == (status == 1));
+    if (error == 0) {
+        corpus_check_index_entries(buf, len, &index, entries, n);
+        /* Even an empty archive needs room for its hash table. */
+        CHECK(cpio_index_init(&index, buf, len, index_buf, index_len - 1) != 0);
+        CHECK(cpio_index_init(&index, buf, len, index_buf, index_len) == 0);
+    }
+    corpus_check_parallel(buf, len, &index, error, n);
+
+    if (error == 0) {
+        int bad = corpus_check_verify(buf, len, entries, n);
+        if (expect.bad_check != CORPUS_ANY) {
+            CHECK(bad == expect.bad_check);
+        }
+        corpus_check_paths(buf, len, &index);
+    }
+
+    int lz4_ok = corpus_check_lz4(entries, n);
+    if (expect.lz4_ok != CORPUS_ANY) {
+        CHECK(lz4_ok == expect.lz4_ok);
+    }
+
+    free(index_buf);
+    free(buf);
+    free(entries);
+}
+
+/*
+ * "hello hello hello!" as an LZ4 member: 6 literals, a match of 11 bytes at
+ * offset 6, and a final literal.
+ */
+static const unsigned char corpus_lz4[] = {
+    18, 0, 0, 0,
+    0x67, 'h', 'e', 'l', 'l', 'o', ' ', 6, 0,
+    0x10, '!',
+};
+#define CORPUS_LZ4_TOKEN 4
+#define CORPUS_LZ4_OFFSET 11
+
+/* Entries of the base archive. */
+enum {
+    BASE_A,
+    BASE_DIR,
+    BASE_DIR_B,
+    BASE_LINK1,
+    BASE_C,
+    BASE_LINK2,
+    BASE_LZ4,
+    BASE_TRAILER,
+    BASE_COUNT = BASE_TRAILER,
+};
+
+struct corpus_base {
+    struct archive archive;
+    struct archive_entry entries[BASE_TRAILER + 1];
+};
+
+/* Options to build variants of the base archive. */
+#define BASE_NO_LINK2 1
+#define BASE_NO_TRAILER 2
+#define BASE_LINK2_SYMLINK 4
+#define BASE_LINK2_SINGLE 8
+
+/*
+ * A small archive with a nested directory, an empty file, a pair of hard
+ * links whose data is stored with the second one and an LZ4 member.
+ */
+static void corpus_base_init(struct corpus_base *base, const char *magic, unsigned int options)
+{
+    struct archive *a = &base->archive;
+    unsigned int link2_mode = options & BASE_LINK2_SYMLINK ? 0120777 : ARCHIVE_REG;
+    unsigned int link2_nlink = options & BASE_LINK2_SINGLE ? 1 : 2;
+
+    archive_init(a);
+    memset(base->entries, 0, sizeof(base->entries));
+    archive_add(a, magic, "a", ARCHIVE_REG, 1, 1, "hello", 5, &base->entries[BASE_A]);
+    archive_add(a, magic, "dir", ARCHIVE_DIR, 2, 2, NULL, 0, &base->entries[BASE_DIR]);
+    archive_add(a, magic, "dir/b", ARCHIVE_REG, 1, 3, NULL, 0, &base->entries[BASE_DIR_B]);
+    archive_add(a, magic, "link1", ARCHIVE_REG, 2, 40, NULL, 0, &base->entries[BASE_LINK1]);
+    archive_add(a, magic, "c", ARCHIVE_REG, 1, 4, "0123456789abc", 13, &base->entries[BASE_C]);
+    if (!(options & BASE_NO_LINK2)) {
+        archive_add(a, magic, "link2", link2_mode, link2_nlink, 40, "payload", 7, &base->entries[BASE_LINK2]);
+    }
+    archive_add(a, magic, "z.lz4", ARCHIVE_REG, 1, 5, corpus_lz4, sizeof(corpus_lz4), &base->entries[BASE_LZ4]);
+    if (!(options & BASE_NO_TRAILER)) {
+        base->entries[BASE_TRAILER].header = archive_add(a, magic, "TRAILER!!!", 0, 1, 0, NULL, 0,
+                                                         &base->entries[BASE_TRAILER]);
+    }
+}
+
+static void corpus_base_run(const char *name, struct corpus_base *base, struct corpus_expect expect)
+{
+    corpus_run(name, base->archive.data, base->archive.len, expect);
+    archive_free(&base->archive);
+}
+
+/* Overwrite the raw text of a header field, e.g. with characters that are not hex digits. */
+static void corpus_set_raw(struct corpus_base *base, int entry, unsigned long field, const char *text)
+{
+    memcpy(base->archive.data + base->entries[entry].header + field, text, ARCHIVE_FIELD_LEN);
+}
+
+static void corpus_set_field(struct corpus_base *base, int entry, unsigned long field, unsigned long value)
+{
+    archive_set_field(&base->archive, base->entries[entry].header, field, value);
+}
+
+/* Size of the data of an entry, checked through the linear and the indexed lookup. */
+static void corpus_check_size(const char *name, unsigned int options, const char *file, unsigned long expected)
+{
+    struct corpus_base base;
+    unsigned long size = ~0ul;
+    unsigned long index_size = ~0ul;
+    cpio_index_t index;
+    char index_buf[4096];
+
+    corpus_base_init(&base, CPIO_HEADER_MAGIC, options);
+    corpus_case = name;
+    cpio_get_file(base.archive.data, base.archive.len, file, &size);
+    CHECK(size == expected);
+    CHECK(cpio_index_init(&index, base.archive.data, base.archive.len, index_buf, sizeof(index_buf)) == 0);
+    cpio_index_get_file(&index, file, &index_size);
+    CHECK(index_size == expected);
+    archive_free(&base.archive);
+}
+
+/* Every strict prefix of an archive, with the outcome derived from its layout. */
+static void corpus_prefixes(const char *magic)
+{
+    struct corpus_base base;
+    char name[64];
+
+    corpus_base_init(&base, magic, 0);
+    for (unsigned long len = 0; len < base.archive.len; len++) {
+        int fit = 0;
+        while (fit <= BASE_TRAILER) {
+            const struct archive_entry *e = &base.entries[fit];
+            if (e->name_end > len || (e->size > 0 && e->data + e->size > len)) {
+                break;
+            }
+            fit++;
+        }
+        struct corpus_expect expect = expect_malformed;
+        if (fit > BASE_TRAILER) {
+            expect = expect_count(BASE_COUNT);
+        } else {
+            expect.yielded = fit;
+        }
+        snprintf(name, sizeof(name), "prefix-%s-%lu", magic, len);
+        corpus_run(name, base.archive.data, len, expect);
+    }
+    archive_free(&base.archive);
+}
+
+static void corpus_named(void)
+{
+    struct corpus_base base;
+    struct corpus_expect expect;
+    struct archive a;
+
+    corpus_run("empty", "", 0, expect_malformed);
+
+    archive_init(&a);
+    archive_add_trailer(&a, CPIO_HEADER_MAGIC);
+    corpus_run("trailer-only", a.data, a.len, expect_count(0));
+    archive_free(&a);
+
+    corpus_base_init(&base, CPIO_HEADER_MAGIC, 0);
+    corpus_base_run("base", &base, expect_count(BASE_COUNT));
+    corpus_base_init(&base, CPIO_HEADER_MAGIC_CRC, 0);
+    corpus_base_run("base-crc", &base, expect_count(BASE_COUNT));
+
+    /* Hard links */
+    corpus_check_size("link-resolved", 0, "link1", 7);
+    corpus_check_size("link-holder", 0, "link2", 7);
+    corpus_check_size("link-unresolved-symlink", BASE_LINK2_SYMLINK, "link1", 0);
+    corpus_check_size("link-unresolved-single", BASE_LINK2_SINGLE, "link1", 0);
+    corpus_base_init(&base, CPIO_HEADER_MAGIC, BASE_NO_LINK2);
+    corpus_base_run("link-dangling", &base, expect_count(BASE_COUNT - 1));
+    corpus_base_init(&base, CPIO_HEADER_MAGIC, BASE_LINK2_SYMLINK);
+    corpus_base_run("link-holder-symlink", &base, expect_count(BASE_COUNT));
+    corpus_base_init(&base, CPIO_HEADER_MAGIC, BASE_LINK2_SINGLE);
+    corpus_base_run("link-holder-single", &base, expect_count(BASE_COUNT));
+    corpus_base_init(&base, CPIO_HEADER_MAGIC, 0);
+    corpus_set_field(&base, BASE_LINK1, ARCHIVE_MODE, ARCHIVE_DIR);
+    corpus_base_run("link-dir", &base, expect_count(BASE_COUNT));
+
+    /* Checksums */
+    corpus_base_init(&base, CPIO_HEADER_MAGIC_CRC, 0);
+    corpus_set_field(&base, BASE_C, ARCHIVE_CHECK, 0);
+    expect = expect_count(BASE_COUNT);
+    expect.bad_check = 1;
+    corpus_base_run("check-bad", &base, expect);
+    corpus_base_init(&base, CPIO_HEADER_MAGIC_CRC, 0);
+    base.archive.data[base.entries[BASE_LINK2].data] ^= 1;
+    corpus_base_run("check-bad-link", &base, expect);
+    corpus_base_init(&base, CPIO_HEADER_MAGIC_CRC, 0);
+    memcpy(base.archive.data + base.entries[BASE_DIR_B].header, CPIO_HEADER_MAGIC, 6);
+    corpus_base_run("check-mixed-magic", &base, expect_count(BASE_COUNT));
+
+    /* Magic */
+    corpus_base_init(&base, CPIO_HEADER_MAGIC, 0);
+    base.archive.data[5] = '3';
+    corpus_base_run("magic-bad-first", &base, expect_malformed);
+    corpus_base_init(&base, CPIO_HEADER_MAGIC, 0);
+    base.archive.data[base.entries[BASE_C].header] = 'x';
+    expect = expect_malformed;
+    expect.yielded = BASE_C;
+    corpus_base_run("magic-bad-later", &base, expect);
+
+    /* Name sizes */
+    corpus_base_init(&base, CPIO_HEADER_MAGIC, 0);
+    corpus_set_field(&base, BASE_A, ARCHIVE_NAMESIZE, 0);
+    corpus_base_run("namesize-zero", &base, expect_malformed);
+    corpus_base_init(&base, CPIO_HEADER_MAGIC, 0);
+    corpus_set_field(&base, BASE_DIR_B, ARCHIVE_NAMESIZE, 0xffffffff);
+    expect.yielded = BASE_DIR_B;
+    corpus_base_run("namesize-huge", &base, expect);
+    corpus_base_init(&base, CPIO_HEADER_MAGIC, 0);
+    corpus_set_field(&base, BASE_TRAILER, ARCHIVE_NAMESIZE,
+                     base.archive.len - base.entries[BASE_TRAILER].header - ARCHIVE_HEADER_SIZE + 1);
+    expect.yielded = BASE_COUNT;
+    corpus_base_run("namesize-past-end", &base, expect);
+    corpus_base_init(&base, CPIO_HEADER_MAGIC, 0);
+    corpus_set_field(&base, BASE_DIR_B, ARCHIVE_NAMESIZE, 5);
+    expect.yielded = BASE_DIR_B;
+    corpus_base_run("name-unterminated", &base, expect);
+    corpus_base_init(&base, CPIO_HEADER_MAGIC, 0);
+    corpus_set_field(&base, BASE_TRAILER, ARCHIVE_NAMESIZE, 10);
+    expect.yielded = BASE_COUNT;
+    corpus_base_run("trailer-unterminated", &base, expect);
+
+    /* File sizes */
+    corpus_base_init(&base, CPIO_HEADER_MAGIC, 0);
+    corpus_set_field(&base, BASE_A, ARCHIVE_FILESIZE, 0xffffffff);
+    corpus_base_run("filesize-huge", &base, expect_malformed);
+    corpus_base_init(&base, CPIO_HEADER_MAGIC, BASE_NO_TRAILER);
+    corpus_set_field(&base, BASE_LZ4, ARCHIVE_FILESIZE, base.archive.len - base.entries[BASE_LZ4].data + 1);
+    expect.yielded = BASE_LZ4;
+    corpus_base_run("filesize-past-end", &base, expect);
+    corpus_base_init(&base, CPIO_HEADER_MAGIC, 0);
+    corpus_set_field(&base, BASE_A, ARCHIVE_FILESIZE, 0x20);
+    expect.yielded = 1;
+    corpus_base_run("filesize-into-header", &base, expect);
+
+    /* Fields that are not plain hex digits */
+    corpus_base_init(&base, CPIO_HEADER_MAGIC, 0);
+    corpus_set_raw(&base, BASE_A, ARCHIVE_FILESIZE, "0000000g");
+    corpus_base_run("filesize-not-hex", &base, expect);
+    corpus_base_init(&base, CPIO_HEADER_MAGIC, 0);
+    corpus_set_raw(&base, BASE_A, ARCHIVE_FILESIZE, "       5");
+    corpus_base_run("filesize-leading-space", &base, expect);
+    corpus_base_init(&base, CPIO_HEADER_MAGIC, 0);
+    corpus_set_raw(&base, BASE_A, ARCHIVE_FILESIZE, "5       ");
+    corpus_base_run("filesize-trailing-space", &base, expect);
+    corpus_base_init(&base, CPIO_HEADER_MAGIC, 0);
+    corpus_set_raw(&base, BASE_A, ARCHIVE_FILESIZE, "\xb0\xb0\xb0\xb0\xb0\xb0\xb0\xb5");
+    corpus_base_run("filesize-high-bit", &base, expect);
+    corpus_base_init(&base, CPIO_HEADER_MAGIC, 0);
+    corpus_set_raw(&base, BASE_C, ARCHIVE_FILESIZE, "0000000D");
+    corpus_set_raw(&base, BASE_TRAILER, ARCHIVE_NAMESIZE, "0000000B");
+    corpus_base_run("upper-case-hex", &base, expect_count(BASE_COUNT));
+    corpus_base_init(&base, CPIO_HEADER_MAGIC, 0);
+    corpus_set_raw(&base, BASE_DIR, ARCHIVE_FILESIZE, "0\0\0\0\0\0\0\0");
+    corpus_set_raw(&base, BASE_A, ARCHIVE_INO, "\xb1\xb1\xb1\xb1\xb1\xb1\xb1\xb1");
+    corpus_set_raw(&base, BASE_C, ARCHIVE_MTIME, "5f00000\x80");
+    corpus_set_raw(&base, BASE_DIR_B, ARCHIVE_NLINK, "\0\0\0\0\0\0\0\0");
+    corpus_base_run("unused-fields-not-hex", &base, expect_count(BASE_COUNT));
+
+    /* Trailer */
+    corpus_base_init(&base, CPIO_HEADER_MAGIC, BASE_NO_TRAILER);
+    expect.yielded = BASE_COUNT;
+    corpus_base_run("trailer-missing", &base, expect);
+    corpus_base_init(&base, CPIO_HEADER_MAGIC, 0);
+    archive_append(&base.archive, "garbage after the trailer", 25);
+    corpus_base_run("trailer-then-garbage", &base, expect_count(BASE_COUNT));
+    corpus_base_init(&base, CPIO_HEADER_MAGIC, 0);
+    archive_add(&base.archive, CPIO_HEADER_MAGIC, "a", ARCHIVE_REG, 1, 6, "other", 5, NULL);
+    archive_add_trailer(&base.archive, CPIO_HEADER_MAGIC);
+    corpus_base_run("trailer-then-entries", &base, expect_count(BASE_COUNT));
+
+    /* Duplicate names, the first one wins */
+    corpus_base_init(&base, CPIO_HEADER_MAGIC, BASE_NO_TRAILER);
+    archive_add(&base.archive, CPIO_HEADER_MAGIC, "a", ARCHIVE_REG, 1, 6, "other", 5, NULL);
+    archive_add(&base.archive, CPIO_HEADER_MAGIC, "dir/b", ARCHIVE_REG, 1, 7, "x", 1, NULL);
+    archive_add_trailer(&base.archive, CPIO_HEADER_MAGIC);
+    corpus_base_run("duplicate-names", &base, expect_count(BASE_COUNT + 2));
+
+    /* LZ4 members */
+    expect = expect_count(BASE_COUNT);
+    expect.lz4_ok = 0;
+    corpus_base_init(&base, CPIO_HEADER_MAGIC, 0);
+    corpus_set_field(&base, BASE_LZ4, ARCHIVE_FILESIZE, sizeof(corpus_lz4) - 1);
+    corpus_base_run("lz4-truncated", &base, expect);
+    archive_init(&a);
+    archive_add(&a, CPIO_HEADER_MAGIC, "short.lz4", ARCHIVE_REG, 1, 1, corpus_lz4, 3, NULL);
+    archive_add_trailer(&a, CPIO_HEADER_MAGIC);
+    expect.count = 1;
+    corpus_run("lz4-no-size", a.data, a.len, expect);
+    archive_free(&a);
+    expect.count = BASE_COUNT;
+    corpus_base_init(&base, CPIO_HEADER_MAGIC, 0);
+    base.archive.data[base.entries[BASE_LZ4].data + CORPUS_LZ4_OFFSET] = 7;
+    corpus_base_run("lz4-offset-too-far", &base, expect);
+    corpus_base_init(&base, CPIO_HEADER_MAGIC, 0);
+    base.archive.data[base.entries[BASE_LZ4].data + CORPUS_LZ4_OFFSET] = 0;
+    corpus_base_run("lz4-offset-zero", &base, expect);
+    corpus_base_init(&base, CPIO_HEADER_MAGIC, 0);
+    base.archive.data[base.entries[BASE_LZ4].data] = 17;
+    corpus_base_run("lz4-size-short", &base, expect);
+    corpus_base_init(&base, CPIO_HEADER_MAGIC, 0);
+    base.archive.data[base.entries[BASE_LZ4].data] = 19;
+    corpus_base_run("lz4-size-long", &base, expect);
+    corpus_base_init(&base, CPIO_HEADER_MAGIC, 0);
+    base.archive.data[base.entries[BASE_LZ4].data + CORPUS_LZ4_TOKEN] = (char) 0xf7;
+    corpus_base_run("lz4-literals-past-end", &base, expect);
+}
+
+/* Values of size, mode and link fields that are likely to hit edge cases. */
+static unsigned long corpus_field_value(struct corpus_base *base, unsigned int *state)
+{
+    static const unsigned long values[] = {
+        0, 1, 2, 3, 4, 5, 7, 8, 0x7f, 0x80, 0xff, 0x100, 0x7fffffff, 0x80000000, 0xfffffffe, 0xffffffff,
+        ARCHIVE_REG, ARCHIVE_DIR, 0120777, 40,
+    };
+    unsigned int pick = bench_rand(state) % (sizeof(values) / sizeof(values[0]) + 2);
+    if (pick < sizeof(values) / sizeof(values[0])) {
+        return values[pick];
+    } else if (pick == sizeof(values) / sizeof(values[0])) {
+        return base->archive.len - bench_rand(state) % 8;
+    }
+    return bench_rand(state);
+}
+
+/* Randomly mutated variants of the base archive, only checked for consistency. */
+static void corpus_mutations(unsigned long count, unsigned int seed)
+{
+    static const char chars[] = "0123456789abcdefABCDEFg \x80\xff";
+    static const unsigned long fields[] = {
+        ARCHIVE_INO, ARCHIVE_MODE, ARCHIVE_NLINK, ARCHIVE_FILESIZE, ARCHIVE_NAMESIZE, ARCHIVE_CHECK,
+    };
+    unsigned int state = seed ? seed : 1;
+    char name[64];
+
+    for (unsigned long i = 0; i < count; i++) {
+        struct corpus_base base;
+        corpus_base_init(&base, i & 1 ? CPIO_HEADER_MAGIC_CRC : CPIO_HEADER_MAGIC, 0);
+        struct archive *a = &base.archive;
+        unsigned int rounds = 1 + bench_rand(&state) % 4;
+
+        for (unsigned int r = 0; r < rounds && a->len > 0; r++) {
+            const struct archive_entry *e = &base.entries[bench_rand(&state) % (BASE_TRAILER + 1)];
+            unsigned long field = fields[bench_rand(&state) % (sizeof(fields) / sizeof(fields[0]))];
+            unsigned long at = e->header + field + bench_rand(&state) % ARCHIVE_FIELD_LEN;
+
+            switch (bench_rand(&state) % 6) {
+            case 0:
+                a->data[bench_rand(&state) % a->len] ^= 1 << bench_rand(&state) % 8;
+                break;
+            case 1:
+                a->data[bench_rand(&state) % a->len] = bench_rand(&state);
+                break;
+            case 2:
+                /* A single character of a field, which also covers invalid hex digits */
+                if (at < a->len) {
+                    a->data[at] = chars[bench_rand(&state) % (sizeof(chars) - 1)];
+                }
+                break;
+            case 3:
+                if (e->header + field + ARCHIVE_FIELD_LEN <= a->len) {
+                    archive_set_field(a, e->header, field, corpus_field_value(&base, &state));
+                }
+                break;
+            case 4:
+                a->len = bench_rand(&state) % a->len;
+                break;
+            case 5: {
+                /* Copy one header over another, e.g. making two entries share an inode */
+                const struct archive_entry *from = &base.entries[bench_rand(&state) % (BASE_TRAILER + 1)];
+                if (from->header + ARCHIVE_HEADER_SIZE <= a->len && e->header + ARCHIVE_HEADER_SIZE <= a->len) {
+                    memmove(a->data + e->header, a->data + from->header, ARCHIVE_HEADER_SIZE);
+                }
+                break;
+            }
+            }
+        }
+        snprintf(name, sizeof(name), "mutation-%u-%lu", seed, i);
+        corpus_base_run(name, &base, expect_any);
+    }
+}
+
+int corpus_main(int argc, char **argv)
+{
+    unsigned long mutations = 20000;
+    unsigned int seed = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:s:v")) != -1) {
+        switch (opt) {
+        case 'n':
+            mutations = strtoul(optarg, NULL, 0);
+            break;
+        case 's':
+            seed = strtoul(optarg, NULL, 0);
+            break;
+        case 'v':
+            corpus_verbose = 1;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-n mutations] [-s seed] [-v]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    corpus_named();
+    corpus_prefixes(CPIO_HEADER_MAGIC);
+    corpus_prefixes(CPIO_HEADER_MAGIC_CRC);
+    corpus_mutations(mutations, seed);
+
+    printf("%lu archives, %lu failures\n", corpus_cases, corpus_failures);
+    return corpus_failures != 0;
+}
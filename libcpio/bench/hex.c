@@ -0,0 +1,295 @@
+/*
+ * Copyright 2026, agent
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/*
+ * Checks and benchmarks the SWAR header decoder against cpio_parse_hex_str,
+ * which decodes one character at a time.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <cpio/cpio.h>
+
+#include "cpio_internal.h"
+#include "bench.h"
+
+#define HEX_HEADERS 4096
+#define HEX_RANDOM_HEADERS 1000000
+#define HEX_MIN_NS 200000000ull
+
+static const char hex_lower[] = "0123456789abcdef";
+static const char hex_upper[] = "0123456789ABCDEF";
+static const char hex_digits[] = "0123456789abcdefABCDEF";
+
+static unsigned long hex_failures;
+
+static void hex_fail(const char *what, const char *field, unsigned long got, unsigned long expected)
+{
+    if (hex_failures++ < 20) {
+        fprintf(stderr, "FAIL %s: \"", what);
+        for (int i = 0; i < CPIO_FIELD_LEN; i++) {
+            unsigned char c = field[i];
+            fprintf(stderr, c >= 0x20 && c < 0x7f && c != '"' && c != '\\' ? "%c" : "\\x%02x", c);
+        }
+        fprintf(stderr, "\" decoded as %lx instead of %lx\n", got, expected);
+    }
+}
+
+static int hex_is_digit(unsigned char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+/* A header whose fields are all "00000000", the field under test is the file size. */
+static void hex_header_init(struct cpio_header *header)
+{
+    memcpy(header->c_magic, CPIO_HEADER_MAGIC, sizeof(header->c_magic));
+    memset(header->c_ino, '0', sizeof(*header) - sizeof(header->c_magic));
+}
+
+/* Decode the file size field with both decoders and the SWAR mask, and compare them. */
+static void hex_check_field(const struct cpio_header *header, const char *what)
+{
+    const char *field = header->c_filesize;
+    unsigned long expected = cpio_parse_hex_str(field, CPIO_FIELD_LEN);
+    unsigned long got = cpio_decode_field(header, CPIO_FIELD_FILESIZE);
+    if (got != expected) {
+        hex_fail(what, field, got, expected);
+    }
+
+    /* The mask must flag exactly the bytes that are hex digits. */
+    unsigned long long mask = cpio_swar_hex_mask(cpio_swar_load(field));
+    for (int i = 0; i < CPIO_FIELD_LEN; i++) {
+        if (!!(mask & (0x80ull << (i * 8))) != hex_is_digit(field[i])) {
+            hex_fail("mask", field, (mask >> (i * 8 + 7)) & 1, hex_is_digit(field[i]));
+            break;
+        }
+    }
+}
+
+/*
+ * Every byte value at every position, with the other positions set to each
+ * hex digit. The SWAR range checks are carry free within each byte, so this
+ * covers the classification of all possible fields.
+ */
+static void hex_check_bytes(void)
+{
+    struct cpio_header header;
+    hex_header_init(&header);
+
+    for (int pos = 0; pos < CPIO_FIELD_LEN; pos++) {
+        for (const char *d = hex_digits; *d; d++) {
+            memset(header.c_filesize, *d, CPIO_FIELD_LEN);
+            for (int c = 0; c < 256; c++) {
+                header.c_filesize[pos] = c;
+                hex_check_field(&header, "byte");
+            }
+        }
+    }
+}
+
+/* Every pair of byte values at every pair of positions, e.g. two invalid characters. */
+static void hex_check_pairs(void)
+{
+    static const char fillers[] = "7F";
+    struct cpio_header header;
+    hex_header_init(&header);
+
+    for (const char *f = fillers; *f; f++) {
+        for (int a = 0; a < CPIO_FIELD_LEN; a++) {
+            for (int b = a + 1; b < CPIO_FIELD_LEN; b++) {
+                memset(header.c_filesize, *f, CPIO_FIELD_LEN);
+                for (int x = 0; x < 65536; x++) {
+                    header.c_filesize[a] = x & 0xff;
+                    header.c_filesize[b] = x >> 8;
+                    hex_check_field(&header, "pair");
+                }
+            }
+        }
+    }
+}
+
+/*
+ * Every 32-bit value, written in lower and in upper case digits. Only the
+ * SWAR decoder is run on all of them, the expected value is known. With
+ * hex_check_bytes this covers every valid field, as digits are mapped to
+ * nibbles independently of their position and case.
+ */
+static void hex_check_values(const char *digits)
+{
+    struct cpio_header header;
+    int nibbles[CPIO_FIELD_LEN] = { 0 };
+    unsigned long value = 0;
+
+    hex_header_init(&header);
+    while (1) {
+        if (cpio_decode_field(&header, CPIO_FIELD_FILESIZE) != value) {
+            hex_fail("value", header.c_filesize, cpio_decode_field(&header, CPIO_FIELD_FILESIZE), value);
+        }
+        /* The reference decoder is much slower, only run it on a sample. */
+        if ((value & 0xfff) == 0xabc && cpio_parse_hex_str(header.c_filesize, CPIO_FIELD_LEN) != value) {
+            hex_fail("value", header.c_filesize, cpio_parse_hex_str(header.c_filesize, CPIO_FIELD_LEN), value);
+        }
+
+        /* Increment the field like an odometer. */
+        int pos = CPIO_FIELD_LEN - 1;
+        while (pos >= 0 && nibbles[pos] == 15) {
+            nibbles[pos] = 0;
+            header.c_filesize[pos] = digits[0];
+            pos--;
+        }
+        if (pos < 0) {
+            break;
+        }
+        nibbles[pos]++;
+        header.c_filesize[pos] = digits[nibbles[pos]];
+        value++;
+    }
+    if (value != 0xffffffff) {
+        hex_fail("value count", header.c_filesize, value, 0xffffffff);
+    }
+}
+
+/* Random headers, where each field is valid, has an invalid character or is random. */
+static void hex_check_headers(void)
+{
+    static const char invalid[] = " gGxX/:@`\x7f\x80\xb0\xff";
+    unsigned int state = 12345;
+    struct cpio_header header;
+    unsigned long fields[CPIO_NUM_FIELDS];
+
+    hex_header_init(&header);
+    for (int n = 0; n < HEX_RANDOM_HEADERS; n++) {
+        char *s = header.c_ino;
+        for (int i = 0; i < CPIO_NUM_FIELDS * CPIO_FIELD_LEN; i++) {
+            s[i] = hex_digits[bench_rand(&state) % (sizeof(hex_digits) - 1)];
+        }
+        for (int i = 0; i < CPIO_NUM_FIELDS; i++) {
+            unsigned int kind = bench_rand(&state) % 4;
+            if (kind == 1) {
+                s[i * CPIO_FIELD_LEN + bench_rand(&state) % CPIO_FIELD_LEN] =
+                    invalid[bench_rand(&state) % (sizeof(invalid) - 1)];
+            } else if (kind == 2) {
+                for (int j = 0; j < CPIO_FIELD_LEN; j++) {
+                    s[i * CPIO_FIELD_LEN + j] = bench_rand(&state);
+                }
+            }
+        }
+
+        cpio_decode_header(&header, fields);
+        for (int i = 0; i < CPIO_NUM_FIELDS; i++) {
+            unsigned long expected = cpio_parse_hex_str(s + i * CPIO_FIELD_LEN, CPIO_FIELD_LEN);
+            if (fields[i] != expected) {
+                hex_fail("header", s + i * CPIO_FIELD_LEN, fields[i], expected);
+            }
+            if (cpio_decode_field(&header, i) != expected) {
+                hex_fail("header field", s + i * CPIO_FIELD_LEN, cpio_decode_field(&header, i), expected);
+            }
+        }
+    }
+}
+
+int hex_check_main(int argc, char **argv)
+{
+    int quick = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "q")) != -1) {
+        switch (opt) {
+        case 'q':
+            quick = 1;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-q]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    hex_check_bytes();
+    hex_check_pairs();
+    hex_check_headers();
+    if (!quick) {
+        hex_check_values(hex_lower);
+        hex_check_values(hex_upper);
+    }
+
+    printf("%s, %lu failures\n", quick ? "quick check" : "exhaustive check", hex_failures);
+    return hex_failures != 0;
+}
+
+/* Consumes results, so that the compiler cannot drop the decoding. */
+static volatile unsigned long hex_sink;
+
+static void hex_decode_old(const struct cpio_header *header, unsigned long fields[CPIO_NUM_FIELDS])
+{
+    const char *s = header->c_ino;
+    for (int i = 0; i < CPIO_NUM_FIELDS; i++, s += CPIO_FIELD_LEN) {
+        fields[i] = cpio_parse_hex_str(s, CPIO_FIELD_LEN);
+    }
+}
+
+typedef void (*hex_decode_fn)(const struct cpio_header *header, unsigned long fields[CPIO_NUM_FIELDS]);
+
+/* Decode all headers repeatedly until it took long enough, returning ns per header. */
+static double hex_measure(const char *name, hex_decode_fn decode, const struct cpio_header *const *headers)
+{
+    unsigned long fields[CPIO_NUM_FIELDS];
+    unsigned long reps = 1;
+    unsigned long long elapsed;
+
+    while (1) {
+        unsigned long long start = bench_now();
+        for (unsigned long r = 0; r < reps; r++) {
+            for (int i = 0; i < HEX_HEADERS; i++) {
+                decode(headers[i], fields);
+                hex_sink += fields[CPIO_FIELD_FILESIZE] + fields[CPIO_FIELD_NAMESIZE];
+            }
+        }
+        elapsed = bench_now() - start;
+        if (elapsed >= HEX_MIN_NS) {
+            break;
+        }
+        reps *= 2;
+    }
+
+    double ns = (double) elapsed / (reps * HEX_HEADERS);
+    printf("%-32s %10.2f %12.1f\n", name, ns, sizeof(struct cpio_header) / ns * 1e9 / (1 << 20));
+    return ns;
+}
+
+int hex_bench_main(int argc, char **argv)
+{
+    struct bench_archive bench;
+    const struct cpio_header *headers[HEX_HEADERS];
+    (void) argc;
+    (void) argv;
+
+    /* Headers as they appear in an archive, i.e. with varying alignment of the fields. */
+    bench_archive_generate(&bench, HEX_HEADERS, 1024, 0, 3);
+    for (int i = 0; i < HEX_HEADERS; i++) {
+        headers[i] = (const struct cpio_header *)(bench.archive.data + bench.entries[i].header);
+    }
+
+    printf("%-32s %10s %12s\n", "decoder", "ns/header", "MiB/s");
+    double old_ns = hex_measure("cpio_parse_hex_str", hex_decode_old, headers);
+    double new_ns = hex_measure("cpio_decode_header", cpio_decode_header, headers);
+
+    /* Fields that are not all hex digits take the slow path, which is slowest for the last digit. */
+    for (int i = 0; i < HEX_HEADERS; i++) {
+        char *s = bench.archive.data + bench.entries[i].header + sizeof(headers[i]->c_magic);
+        for (int f = 0; f < CPIO_NUM_FIELDS; f++) {
+            s[f * CPIO_FIELD_LEN + CPIO_FIELD_LEN - 1] = ' ';
+        }
+    }
+    hex_measure("cpio_decode_header (non-hex)", cpio_decode_header, headers);
+
+    printf("speedup %.2fx\n", old_ns / new_ns);
+    bench_archive_free(&bench);
+    return 0;
+}
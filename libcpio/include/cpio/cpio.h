@@ -8,11 +8,17 @@
 
 /* Magic identifiers for the "cpio" file format. */
 #define CPIO_HEADER_MAGIC "070701"
+#define CPIO_HEADER_MAGIC_CRC "070702"
 #define CPIO_FOOTER_MAGIC "TRAILER!!!"
 #define CPIO_ALIGNMENT 4
 
+/* File type bits of the mode of an entry. */
+#define CPIO_MODE_TYPE 0170000
+#define CPIO_MODE_REG  0100000
+#define CPIO_MODE_DIR  0040000
+
 struct cpio_header {
-    char c_magic[6];      /* Magic header '070701'. */
+    char c_magic[6];      /* Magic header '070701', or '070702' with checksum. */
     char c_ino[8];        /* "i-node" number. */
     char c_mode[8];       /* Permisions. */
     char c_uid[8];        /* User ID. */
@@ -39,12 +45,125 @@ struct cpio_info {
 };
 
 /**
- * Retrieve file information from a provided CPIO list index
+ * A CPIO entry as returned by the archive iterator. All pointers point into
+ * the archive itself, nothing is copied. Hard links whose data is stored with
+ * another entry of the archive report the data and size of that entry.
+ */
+struct cpio_entry {
+    /// The NULL terminated file name of the entry
+    const char *name;
+    /// The size of the file data
+    unsigned long size;
+    /// The file mode, i.e. type and permissions
+    unsigned int mode;
+    /// The modification time
+    unsigned long mtime;
+    /// The location of the file data
+    const void *data;
+};
+
+/**
+ * Forward iterator over the entries of a CPIO archive. It does not allocate
+ * and walks the archive in a single pass, see cpio_iter_init().
+ */
+typedef struct cpio_iter {
+    /// The location of the CPIO archive
+    const void *archive;
+    /// The length of the CPIO archive
+    unsigned long len;
+    /// The next header to parse
+    const struct cpio_header *header;
+    /// The remaining length of the archive starting at header
+    unsigned long remaining;
+    /// 0 while iterating, 1 once the trailer was reached, -1 on error
+    int status;
+    /// Optional table of the entries holding the data of hard links, see cpio_iter_set_links()
+    const struct cpio_header **links;
+    /// The number of slots of the link table minus one
+    unsigned long links_mask;
+    /// The number of entries in the link table
+    unsigned long links_count;
+    /// Non-zero if the link table misses holders, e.g. because it is full
+    int links_full;
+} cpio_iter_t;
+
+/**
+ * Checksum verification modes of a CPIO index, see cpio_index_set_verify().
+ */
+enum cpio_verify_mode {
+    /// Checksums are ignored
+    CPIO_VERIFY_OFF,
+    /// Checksums are verified on the first access of an entry
+    CPIO_VERIFY_LAZY,
+    /// All checksums are verified up front, and entries failing are hidden
+    CPIO_VERIFY_EAGER,
+};
+
+/**
+ * Checksum state of an indexed entry.
+ */
+enum cpio_check_state {
+    /// The entry has no checksum, i.e. it uses the "070701" format
+    CPIO_CHECK_NONE,
+    /// The checksum has not been verified yet
+    CPIO_CHECK_PENDING,
+    /// The checksum matches the data
+    CPIO_CHECK_OK,
+    /// The checksum does not match the data
+    CPIO_CHECK_BAD,
+};
+
+/**
+ * A single entry of an indexed CPIO archive. All pointers point into the
+ * archive itself, nothing is copied. Hard links are resolved to the data of
+ * the entry of the same inode holding it.
+ */
+typedef struct cpio_index_entry {
+    /// The header of the entry
+    const struct cpio_header *header;
+    /// The NULL terminated file name of the entry
+    const char *name;
+    /// The location of the file data
+    const void *data;
+    /// The size of the file data
+    unsigned long size;
+    /// The hash of the file name
+    unsigned int hash;
+    /// The checksum stored in the header of a "070702" entry
+    unsigned int check;
+    /// Cached result of the checksum verification, see enum cpio_check_state
+    unsigned int check_state;
+} cpio_index_entry_t;
+
+/**
+ * An index over a CPIO archive that allows looking up files by name or by
+ * position in constant time. The index lives in caller provided memory, see
+ * cpio_index_buf_size() and cpio_index_init().
+ */
+typedef struct cpio_index {
+    /// Dense array of entries, in archive order
+    cpio_index_entry_t *entries;
+    /// The number of files in the CPIO archive
+    unsigned int file_count;
+    /// The maximum size of a file name
+    unsigned int max_path_sz;
+    /// Open addressing hash table holding (entry position + 1), 0 is empty
+    unsigned int *buckets;
+    /// The number of buckets minus one, the number of buckets is a power of two
+    unsigned int bucket_mask;
+    /// How checksums of "070702" entries are verified on lookup
+    enum cpio_verify_mode verify;
+} cpio_index_t;
+
+/**
+ * Retrieve file information from a provided CPIO list index. Scans the
+ * archive in O(n) time, plus a second scan if the entry is a hard link whose
+ * data is stored with another entry. Use a cpio_index_t for repeated lookups.
  * @param[in] archive  The location of the CPIO archive
  * @param[in] index    The index of the CPIO entry to query
- * @param[out] name    A pointer to the file name of the entry. This name is not
- *                     NULL terminated but it will not exceed max_path_sz as
- *                     reported by cpio_info.
+ * @param[out] name    A pointer to the NULL terminated file name of the entry,
+ *                     whose length does not exceed max_path_sz as reported by
+ *                     cpio_info.
  * @param[out] size    The size of the file in question
  * @return             The location of the file in memory; NULL if the index
  *                     exceeds the number of files in the CPIO archive.
@@ -52,7 +171,9 @@ struct cpio_info {
 const void *cpio_get_entry(const void *archive, unsigned long len, int index, const char **name, unsigned long *size);
 
 /**
- * Retrieve file information from a provided file name
+ * Retrieve file information from a provided file name. Scans the archive in
+ * O(n) time, plus a second scan if the file is a hard link whose data is
+ * stored with another entry. Use a cpio_index_t for repeated lookups.
  * @param[in] archive  The location of the CPIO archive
  * @param[in] name     The name of the file in question.
  * @param[out] size    The retrieved size of the file in question
@@ -73,8 +194,525 @@ int cpio_info(const void *archive, unsigned long len, struct cpio_info *info);
  * Writes the list of file names contained within a CPIO archive into
  * a provided buffer
  * @param[in] archive  The location of the CPIO archive
- * @param[in] buf      A memory location to store the CPIO file list to
+ * @param[in] buf      An array of buf_len strings, each of which must hold at
+ *                     least max_path_sz + 1 characters as reported by cpio_info
  * @param[in] buf_len  The length of the provided buf
  */
 void cpio_ls(const void *archive, unsigned long len, char **buf, unsigned long buf_len);
 
+
+/**
+ * Initialise an iterator over a CPIO archive
+ * @param[out] iter    The iterator to initialise
+ * @param[in] archive  The location of the CPIO archive
+ * @param[in] len      The length of the CPIO archive
+ */
+void cpio_iter_init(cpio_iter_t *iter, const void *archive, unsigned long len);
+
+/**
+ * Returns the size of the buffer for cpio_iter_set_links() to hold the link
+ * table of an archive with the given number of files.
+ * @param[in] file_count  The number of files, e.g. as reported by cpio_info
+ * @return                The buffer size in bytes
+ */
+unsigned long cpio_iter_links_buf_size(unsigned int file_count);
+
+/**
+ * Provide memory to an iterator for remembering the entries that hold the
+ * data of hard links. Hard links whose data is stored with an earlier entry,
+ * as written by cpio_builder, are then resolved in O(1) time, and those whose
+ * data is stored with a later entry by searching the rest of the archive only.
+ * Call this before the first cpio_iter_next().
+ * @param[in] iter     An initialised iterator
+ * @param[in] buf      Memory for the link table, suitably aligned for pointers,
+ *                     which must outlive the iterator. If it is smaller than
+ *                     cpio_iter_links_buf_size(), links whose holder did not
+ *                     fit are resolved by rescanning the archive.
+ * @param[in] buf_len  The length of the provided buf
+ * @return             Non-zero on error, i.e. buf is NULL or too small to hold
+ *                     a single entry.
+ */
+int cpio_iter_set_links(cpio_iter_t *iter, void *buf, unsigned long buf_len);
+
+/**
+ * Retrieve the next entry of a CPIO archive. Runs in O(1) time, except for
+ * hard links whose data is stored with another entry. Without a link table
+ * these are resolved by rescanning the archive in O(n) time, so walking an
+ * archive with many hard links takes O(n * links) time. Provide a link table
+ * with cpio_iter_set_links() to walk such archives in O(n) time.
+ * @param[in] iter     An initialised iterator
+ * @param[out] entry   The entry to populate, may be NULL to skip an entry
+ *                     without resolving it
+ * @return             0 if an entry was returned, 1 if the end of the archive
+ *                     was reached and -1 if the archive is malformed.
+ */
+int cpio_iter_next(cpio_iter_t *iter, struct cpio_entry *entry);
+
+/**
+ * Rewind an iterator to the first entry of the archive
+ * @param[in] iter     An initialised iterator
+ */
+void cpio_iter_reset(cpio_iter_t *iter);
+
+/**
+ * Returns the size of the buffer required by cpio_index_init() to index an
+ * archive with the given number of files.
+ * @param[in] file_count  The number of files, e.g. as reported by cpio_info
+ * @return                The required buffer size in bytes
+ */
+unsigned long cpio_index_buf_size(unsigned int file_count);
+
+/**
+ * Builds an index over a CPIO archive in a single pass over the archive.
+ * @param[out] index    The index to initialise
+ * @param[in] archive   The location of the CPIO archive
+ * @param[in] len       The length of the CPIO archive
+ * @param[in] buf       Memory used to store the index, must be suitably aligned
+ *                      for pointers and outlive the index
+ * @param[in] buf_len   The length of the provided buf
+ * @return              Non-zero on error, i.e. the archive is malformed or buf
+ *                      is too small.
+ */
+int cpio_index_init(cpio_index_t *index, const void *archive, unsigned long len,
+                    void *buf, unsigned long buf_len);
+
+/**
+ * Retrieve file information from a provided CPIO list index using an index.
+ * Runs in O(1) time, plus a one-off checksum verification if enabled. The
+ * result of the verification is cached in the index, so lookups modify it.
+ * @param[in,out] index An initialised CPIO index
+ * @param[in] n        The index of the CPIO entry to query
+ * @param[out] name    A pointer to the NULL terminated file name of the entry
+ * @param[out] size    The size of the file in question
+ * @return             The location of the file in memory; NULL if the index
+ *                     exceeds the number of files in the CPIO archive or the
+ *                     checksum of the entry does not match.
+ */
+const void *cpio_index_get_entry(cpio_index_t *index, int n, const char **name, unsigned long *size);
+
+/**
+ * Retrieve file information from a provided file name using an index.
+ * Runs in O(1) expected time, plus a one-off checksum verification if enabled.
+ * The result of the verification is cached in the index, so lookups modify it.
+ * @param[in,out] index An initialised CPIO index
+ * @param[in] name     The name of the file in question.
+ * @param[out] size    The retrieved size of the file in question
+ * @return             The location of the file in memory; NULL if the file
+ *                     does not exist or its checksum does not match.
+ */
+const void *cpio_index_get_file(cpio_index_t *index, const char *name, unsigned long *size);
+
+/**
+ * Set the checksum verification mode of an index. Indexes are initialised with
+ * verification turned off. Results are cached per entry, so the data of each
+ * entry is summed at most once.
+ * @param[in] index    An initialised CPIO index
+ * @param[in] mode     The verification mode
+ * @return             Non-zero if mode is CPIO_VERIFY_EAGER and the checksum
+ *                     of any entry does not match.
+ */
+int cpio_index_set_verify(cpio_index_t *index, enum cpio_verify_mode mode);
+
+/**
+ * Compute the checksum used by "070702" archives, i.e. the 32-bit sum of all
+ * bytes of the file data.
+ * @param[in] data     The file data
+ * @param[in] len      The length of the file data
+ * @return             The checksum
+ */
+unsigned int cpio_checksum(const void *data, unsigned long len);
+
+/**
+ * Task function used by the parallel index builder.
+ * @param[in] arg      Opaque argument to pass to the task
+ * @param[in] task     The number of the task to run, from 0 to num_tasks - 1
+ */
+typedef void (*cpio_task_fn)(void *arg, unsigned int task);
+
+/**
+ * Caller supplied function that runs 'num_tasks' tasks, by calling
+ * task(arg, i) for every i in [0, num_tasks). The tasks are independent and
+ * may run concurrently on any number of threads or cores. The function must
+ * only return once all tasks have completed.
+ * @param[in] cookie     The cookie passed to cpio_index_init_parallel
+ * @param[in] task       The task function
+ * @param[in] arg        The argument to pass to the task function
+ * @param[in] num_tasks  The number of tasks to run
+ */
+typedef void (*cpio_run_tasks_fn)(void *cookie, cpio_task_fn task, void *arg, unsigned int num_tasks);
+
+/**
+ * Returns the size of the scratch memory required by cpio_index_init_parallel()
+ * @param[in] len        The length of the CPIO archive
+ * @param[in] num_tasks  The number of tasks the archive is split into
+ * @return               The required scratch size in bytes
+ */
+unsigned long cpio_index_scratch_size(unsigned long len, unsigned int num_tasks);
+
+/**
+ * Builds the same index as cpio_index_init(), but splits the archive into
+ * 'num_tasks' chunks that are scanned for headers in parallel. Candidate
+ * headers are then confirmed by a serial pass that follows the header chain.
+ * @param[out] index       The index to initialise
+ * @param[in] archive      The location of the CPIO archive
+ * @param[in] len          The length of the CPIO archive
+ * @param[in] buf          Memory used to store the index, see cpio_index_init
+ * @param[in] buf_len      The length of the provided buf
+ * @param[in] scratch      Temporary memory, suitably aligned for pointers, that
+ *                         is no longer needed once this function returns
+ * @param[in] scratch_len  The length of the provided scratch memory, at least
+ *                         cpio_index_scratch_size(len, num_tasks)
+ * @param[in] num_tasks    The number of chunks to split the archive into
+ * @param[in] run          Function used to run the scanning tasks
+ * @param[in] cookie       Opaque value passed to run
+ * @return                 Non-zero on error.
+ */
+int cpio_index_init_parallel(cpio_index_t *index, const void *archive, unsigned long len,
+                             void *buf, unsigned long buf_len, void *scratch, unsigned long scratch_len,
+                             unsigned int num_tasks, cpio_run_tasks_fn run, void *cookie);
+
+/**
+ * Output function of a CPIO writer. The writer passes file data to this
+ * function as provided by the caller, without copying it first.
+ * @param[in] cookie   The cookie passed to cpio_writer_init
+ * @param[in] buf      The bytes to write
+ * @param[in] len      The number of bytes to write
+ * @return             Non-zero on error.
+ */
+typedef int (*cpio_write_fn)(void *cookie, const void *buf, unsigned long len);
+
+/**
+ * A piece of the data of a file written with cpio_writer_add().
+ */
+struct cpio_iovec {
+    /// The location of the data
+    const void *base;
+    /// The length of the data
+    unsigned long len;
+};
+
+/// Emit "070702" entries carrying a checksum of the file data
+#define CPIO_WRITER_CRC 1
+
+/**
+ * Streaming writer of "newc" CPIO archives, see cpio_writer_init().
+ */
+typedef struct cpio_writer {
+    /// The output function
+    cpio_write_fn write;
+    /// Opaque value passed to write
+    void *cookie;
+    /// The number of bytes written so far
+    unsigned long offset;
+    /// The alignment of file data relative to the start of the archive
+    unsigned long data_align;
+    /// The inode number of the next entry
+    unsigned int ino;
+    /// Flags passed to cpio_writer_init
+    unsigned int flags;
+    /// Non-zero once an error occurred, all further calls fail
+    int error;
+} cpio_writer_t;
+
+/**
+ * Initialise a CPIO writer
+ *
+ * If data_align is larger than CPIO_ALIGNMENT, the file names are padded with
+ * NULL characters such that the data of every file starts at a multiple of
+ * data_align from the start of the archive. If the archive is placed at an
+ * address aligned to data_align, e.g. a page boundary, file data can be
+ * mapped directly out of the archive. Such archives remain valid "newc"
+ * archives.
+ *
+ * @param[out] writer     The writer to initialise
+ * @param[in] write       Output function for the archive
+ * @param[in] cookie      Opaque value passed to write
+ * @param[in] data_align  The alignment of file data, a power of two; values
+ *                        smaller than CPIO_ALIGNMENT select CPIO_ALIGNMENT
+ * @param[in] flags       Bitwise or of CPIO_WRITER_* flags
+ * @return                Non-zero on error.
+ */
+int cpio_writer_init(cpio_writer_t *writer, cpio_write_fn write, void *cookie,
+                     unsigned long data_align, unsigned int flags);
+
+/**
+ * Append a file to the archive
+ * @param[in] writer   An initialised writer
+ * @param[in] name     The NULL terminated name of the file
+ * @param[in] mode     The file mode, i.e. type and permissions
+ * @param[in] mtime    The modification time
+ * @param[in] iov      The pieces making up the file data, in order
+ * @param[in] iovcnt   The number of pieces
+ * @return             Non-zero on error.
+ */
+int cpio_writer_add(cpio_writer_t *writer, const char *name, unsigned int mode, unsigned long mtime,
+                    const struct cpio_iovec *iov, unsigned int iovcnt);
+
+/**
+ * Terminate the archive by writing the trailer entry. The writer must not be
+ * used afterwards.
+ * @param[in] writer   An initialised writer
+ * @return             Non-zero on error.
+ */
+int cpio_writer_finish(cpio_writer_t *writer);
+
+/**
+ * A file added to a CPIO builder.
+ */
+struct cpio_builder_entry {
+    /// The NULL terminated name of the file
+    const char *name;
+    /// The file mode, i.e. type and permissions
+    unsigned int mode;
+    /// The modification time
+    unsigned long mtime;
+    /// The pieces making up the file data
+    const struct cpio_iovec *iov;
+    /// The number of pieces
+    unsigned int iovcnt;
+    /// The size of the file data
+    unsigned long size;
+    /// The hash of the file data
+    unsigned long long hash;
+    /// Position + 1 of the earlier entry holding the same data, 0 if none
+    unsigned int link;
+    /// The number of entries sharing the data of this entry
+    unsigned int nlink;
+    /// The inode number assigned when writing the archive
+    unsigned int ino;
+};
+
+/**
+ * Builder of CPIO images that stores identical file data only once, see
+ * cpio_builder_init(). Later files with the same content as an earlier file
+ * are written as hard links to it, with a shared inode number and no data.
+ * The reader functions of this library resolve such links transparently.
+ */
+typedef struct cpio_builder {
+    /// The files added so far, in order
+    struct cpio_builder_entry *entries;
+    /// The number of files added so far
+    unsigned int count;
+    /// The maximum number of files
+    unsigned int max_files;
+    /// Open addressing hash table of file data, holding (entry position + 1)
+    unsigned int *buckets;
+    /// The number of buckets minus one, the number of buckets is a power of two
+    unsigned int bucket_mask;
+} cpio_builder_t;
+
+/**
+ * Returns the size of the buffer required by cpio_builder_init()
+ * @param[in] max_files  The maximum number of files added to the builder
+ * @return               The required buffer size in bytes
+ */
+unsigned long cpio_builder_buf_size(unsigned int max_files);
+
+/**
+ * Initialise a deduplicating CPIO builder
+ * @param[out] builder   The builder to initialise
+ * @param[in] max_files  The maximum number of files added to the builder
+ * @param[in] buf        Memory used by the builder, suitably aligned for
+ *                       pointers, of at least cpio_builder_buf_size(max_files)
+ * @param[in] buf_len    The length of the provided buf
+ * @return               Non-zero on error.
+ */
+int cpio_builder_init(cpio_builder_t *builder, unsigned int max_files, void *buf, unsigned long buf_len);
+
+/**
+ * Add a file to the builder. Nothing is copied, the name, the pieces and the
+ * data they describe must remain valid until cpio_builder_finish() returns.
+ * @param[in] builder  An initialised builder
+ * @param[in] name     The NULL terminated name of the file
+ * @param[in] mode     The file mode, i.e. type and permissions
+ * @param[in] mtime    The modification time
+ * @param[in] iov      The pieces making up the file data, in order
+ * @param[in] iovcnt   The number of pieces
+ * @return             Non-zero on error.
+ */
+int cpio_builder_add(cpio_builder_t *builder, const char *name, unsigned int mode, unsigned long mtime,
+                     const struct cpio_iovec *iov, unsigned int iovcnt);
+
+/**
+ * Write all files added to the builder and the trailer to a writer. The
+ * writer must not be used afterwards.
+ * @param[in] builder  An initialised builder
+ * @param[in] writer   An initialised writer
+ * @return             Non-zero on error.
+ */
+int cpio_builder_finish(cpio_builder_t *builder, cpio_writer_t *writer);
+
+/**
+ * Path lookup structure over an indexed CPIO archive, holding the entries
+ * sorted by name. Entries sharing a path prefix are adjacent, so prefix,
+ * directory and glob queries run in time proportional to the number of
+ * matches plus a binary search. See cpio_paths_init().
+ */
+typedef struct cpio_paths {
+    /// The index the paths refer to, through which their entries are looked up
+    cpio_index_t *index;
+    /// Positions of the index entries, sorted by name
+    unsigned int *order;
+    /// The number of entries
+    unsigned int count;
+} cpio_paths_t;
+
+/**
+ * Function called for every match of a path query.
+ * @param[in] cookie    The cookie passed to the query
+ * @param[in] name      The name of the match, pointing into the archive. This
+ *                      is only NULL terminated after name_len characters if
+ *                      the match is an entry of the archive.
+ * @param[in] name_len  The length of the name of the match
+ * @param[in] entry     The entry matched, or NULL for a directory that does
+ *                      not have an entry of its own in the archive
+ * @return              Non-zero to stop the query.
+ */
+typedef int (*cpio_path_fn)(void *cookie, const char *name, unsigned long name_len,
+                            const cpio_index_entry_t *entry);
+
+/**
+ * Returns the size of the buffer required by cpio_paths_init()
+ * @param[in] index    An initialised CPIO index
+ * @return             The required buffer size in bytes
+ */
+unsigned long cpio_paths_buf_size(const cpio_index_t *index);
+
+/**
+ * Sort the entries of an index by name. Runs in O(n log n) time without
+ * allocating.
+ * @param[out] paths   The path lookup structure to initialise
+ * @param[in] index    An initialised CPIO index, which must outlive paths
+ * @param[in] buf      Memory used to store the sorted order
+ * @param[in] buf_len  The length of the provided buf
+ * @return             Non-zero on error.
+ */
+int cpio_paths_init(cpio_paths_t *paths, cpio_index_t *index, void *buf, unsigned long buf_len);
+
+/**
+ * Retrieve the n'th entry in name order
+ * @param[in] paths    An initialised path lookup structure
+ * @param[in] n        The position in name order
+ * @return             The entry, NULL if n exceeds the number of entries.
+ */
+const cpio_index_entry_t *cpio_paths_get(const cpio_paths_t *paths, unsigned int n);
+
+/**
+ * Find all entries whose name starts with the given prefix. Runs in
+ * O(log n) time.
+ * @param[in] paths    An initialised path lookup structure
+ * @param[in] prefix   The prefix, e.g. "lib/"
+ * @param[out] first   The name order position of the first match
+ * @param[out] count   The number of matches, which follow each other in name
+ *                     order, see cpio_paths_get()
+ */
+void cpio_paths_prefix(const cpio_paths_t *paths, const char *prefix, unsigned int *first, unsigned int *count);
+
+/**
+ * List the immediate children of a directory. Each child is reported once,
+ * including directories that only exist implicitly as part of the names of
+ * other entries. Entries below a child directory are skipped, not visited.
+ * @param[in] paths    An initialised path lookup structure
+ * @param[in] dir      The directory, including a trailing '/', or "" for the
+ *                     top level of the archive
+ * @param[in] fn       Function called for every child, in name order
+ * @param[in] cookie   Opaque value passed to fn
+ * @return             0, or the non-zero value returned by fn to stop.
+ */
+int cpio_paths_list_dir(const cpio_paths_t *paths, const char *dir, cpio_path_fn fn, void *cookie);
+
+/**
+ * Find all entries matching a glob pattern, where '?' matches any single
+ * character and '*' any sequence of characters, neither matching '/'. Only
+ * entries sharing the literal prefix of the pattern are examined.
+ * @param[in] paths    An initialised path lookup structure
+ * @param[in] pattern  The pattern, e.g. "lib/lib*.so"
+ * @param[in] fn       Function called for every match, in name order
+ * @param[in] cookie   Opaque value passed to fn
+ * @return             0, or the non-zero value returned by fn to stop.
+ */
+int cpio_paths_glob(const cpio_paths_t *paths, const char *pattern, cpio_path_fn fn, void *cookie);
+
+/*
+ * LZ4 compressed members
+ *
+ * Members whose name ends in CPIO_LZ4_SUFFIX hold a 32-bit little endian
+ * decompressed size followed by a single LZ4 block, which is the layout
+ * produced by e.g. lz4.block.compress(data, store_size=True) in python-lz4.
+ */
+#define CPIO_LZ4_SUFFIX ".lz4"
+
+/// Number of members held by a cpio_lz4_cache_t
+#define CPIO_LZ4_CACHE_SLOTS 4
+
+/**
+ * Check whether a member name marks LZ4 compressed data
+ * @param[in] name     The NULL terminated name of the member
+ * @return             Non-zero if the name ends in CPIO_LZ4_SUFFIX.
+ */
+int cpio_lz4_is_compressed(const char *name);
+
+/**
+ * Retrieve the decompressed size of a compressed member
+ * @param[in] data     The data of the member
+ * @param[in] size     The size of the member
+ * @return             The decompressed size; -1 if the member is too small.
+ */
+long cpio_lz4_size(const void *data, unsigned long size);
+
+/**
+ * Decompress a compressed member into a caller provided buffer. The decoder
+ * validates all offsets and lengths, so malformed data cannot cause reads or
+ * writes outside of the given buffers.
+ * @param[in] data     The data of the member
+ * @param[in] size     The size of the member
+ * @param[out] buf     The buffer to decompress into
+ * @param[in] buf_len  The length of the provided buf
+ * @return             The decompressed size; -1 if the data is malformed or
+ *                     does not fit into buf.
+ */
+long cpio_lz4_decompress(const void *data, unsigned long size, void *buf, unsigned long buf_len);
+
+/**
+ * A small cache of recently decompressed members, see cpio_lz4_cache_init().
+ */
+typedef struct cpio_lz4_cache {
+    struct {
+        /// The data of the cached member within the archive, NULL if unused
+        const void *key;
+        /// The decompressed data
+        void *buf;
+        /// The decompressed size
+        unsigned long size;
+        /// Time of the last use, for least recently used replacement
+        unsigned long last_use;
+    } slots[CPIO_LZ4_CACHE_SLOTS];
+    /// The capacity of each slot
+    unsigned long slot_size;
+    /// Incremented on every lookup
+    unsigned long clock;
+} cpio_lz4_cache_t;
+
+/**
+ * Initialise a cache of decompressed members. The provided memory is split
+ * into CPIO_LZ4_CACHE_SLOTS equally sized slots.
+ * @param[out] cache   The cache to initialise
+ * @param[in] buf      Memory holding the decompressed members
+ * @param[in] buf_len  The length of the provided buf
+ * @return             Non-zero on error.
+ */
+int cpio_lz4_cache_init(cpio_lz4_cache_t *cache, void *buf, unsigned long buf_len);
+
+/**
+ * Retrieve the decompressed data of a compressed member, decompressing it on
+ * demand if it is not in the cache. The returned data is only valid until the
+ * next call, since it may be evicted.
+ * @param[in] cache    An initialised cache
+ * @param[in] data     The data of the member
+ * @param[in] size     The size of the member
+ * @param[out] out_size The decompressed size
+ * @return             The decompressed data; NULL if the data is malformed or
+ *                     does not fit into a slot of the cache.
+ */
+const void *cpio_lz4_cache_get(cpio_lz4_cache_t *cache, const void *data, unsigned long size,
+                               unsigned long *out_size);
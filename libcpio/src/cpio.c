@@ -6,6 +6,8 @@
 
 #include <cpio/cpio.h>
 
+#include "cpio_internal.h"
+
 #ifndef NULL
 #define NULL ((void *)0)
 #endif
@@ -13,6 +15,16 @@
 struct cpio_header_info {
     char const *filename;
     unsigned long filesize;
+    unsigned int mode;
+    unsigned long mtime;
+    /* Hard links share the inode and device numbers. */
+    unsigned long ino;
+    unsigned long nlink;
+    unsigned long devmajor;
+    unsigned long devminor;
+    /* Non-zero if this is a "070702" entry carrying a checksum. */
+    int has_check;
+    unsigned int check;
     const void *data;
     const struct cpio_header *next;
 };
@@ -24,7 +36,7 @@ static unsigned long align_up(unsigned long n, unsigned long align)
 }
 
 /* Parse an ASCII hex string into an integer. */
-static unsigned long parse_hex_str(const char *s, unsigned int max_len)
+unsigned long cpio_parse_hex_str(const char *s, unsigned int max_len)
 {
     unsigned long r = 0;
     unsigned long i;
@@ -45,6 +57,77 @@ static unsigned long parse_hex_str(const char *s, unsigned int max_len)
     return r;
 }
 
+/* Load 8 characters, the first one ending up in the least significant byte. */
+unsigned long long cpio_swar_load(const char *s)
+{
+    const unsigned char *p = (const unsigned char *) s;
+    return (unsigned long long) p[0] | (unsigned long long) p[1] << 8 |
+           (unsigned long long) p[2] << 16 | (unsigned long long) p[3] << 24 |
+           (unsigned long long) p[4] << 32 | (unsigned long long) p[5] << 40 |
+           (unsigned long long) p[6] << 48 | (unsigned long long) p[7] << 56;
+}
+
+/*
+ * Returns a mask with the high bit of every byte set which holds a hex digit.
+ * The range checks only work on 7-bit values, hence bytes with the high bit
+ * set are stripped first and rejected at the end.
+ */
+unsigned long long cpio_swar_hex_mask(unsigned long long x)
+{
+    unsigned long long x7 = x & ~SWAR_HIGH;
+    unsigned long long lower = x7 | (0x20 * SWAR_ONES);
+    /* high bit set if byte >= n, respectively byte <= n */
+#define SWAR_GE(v, n) (((v) + (0x80 - (n)) * SWAR_ONES) & SWAR_HIGH)
+#define SWAR_LE(v, n) (~((v) + (0x7f - (n)) * SWAR_ONES) & SWAR_HIGH)
+    unsigned long long digit = SWAR_GE(x7, '0') & SWAR_LE(x7, '9');
+    unsigned long long alpha = SWAR_GE(lower, 'a') & SWAR_LE(lower, 'f');
+#undef SWAR_GE
+#undef SWAR_LE
+    return (digit | alpha) & ~x & SWAR_HIGH;
+}
+
+/* Convert 8 valid hex digits, as loaded by cpio_swar_load, into their value. */
+static unsigned long swar_hex_value(unsigned long long x)
+{
+    /* Map '0'-'9' to 0-9 and 'a'-'f'/'A'-'F' to 10-15, letters have bit 6 set. */
+    unsigned long long v = (x & (0x0f * SWAR_ONES)) + ((x >> 6) & SWAR_ONES) * 9;
+    /* Merge nibbles into bytes, bytes into halfwords and halfwords into a word. */
+    v = ((v << 4) | (v >> 8)) & 0x00ff00ff00ff00ffull;
+    v = ((v << 8) | (v >> 16)) & 0x0000ffff0000ffffull;
+    return (unsigned long)(((v << 16) | (v >> 32)) & 0xffffffffull);
+}
+
+/*
+ * Decode all hex fields of a header. Each field is converted with a handful
+ * of 64-bit operations. Fields containing non-hex characters take the slow
+ * path to keep the semantics of cpio_parse_hex_str, which stops at the first
+ * invalid character.
+ */
+void cpio_decode_header(const struct cpio_header *header, unsigned long fields[CPIO_NUM_FIELDS])
+{
+    const char *s = header->c_ino;
+
+    for (int i = 0; i < CPIO_NUM_FIELDS; i++, s += CPIO_FIELD_LEN) {
+        unsigned long long x = cpio_swar_load(s);
+        if (cpio_swar_hex_mask(x) == SWAR_HIGH) {
+            fields[i] = swar_hex_value(x);
+        } else {
+            fields[i] = cpio_parse_hex_str(s, CPIO_FIELD_LEN);
+        }
+    }
+}
+
+/* Decode a single hex field of a header. */
+unsigned long cpio_decode_field(const struct cpio_header *header, enum cpio_field field)
+{
+    const char *s = header->c_ino + field * CPIO_FIELD_LEN;
+    unsigned long long x = cpio_swar_load(s);
+    if (cpio_swar_hex_mask(x) == SWAR_HIGH) {
+        return swar_hex_value(x);
+    }
+    return cpio_parse_hex_str(s, CPIO_FIELD_LEN);
+}
+
 /*
  * Compare up to 'n' characters in a string.
  *
@@ -77,6 +160,7 @@ static char *cpio_strcpy(char *to, const char *from)
         to++;
         from++;
     }
+    *to = 0;
     return save;
 }
 
@@ -94,7 +178,7 @@ static unsigned long cpio_len_next(unsigned long len, const void *prev, const vo
     if (len < diff) {
         return 0;
     }
-    return len;
+    return len - diff;
 }
 
 /*
@@ -106,8 +190,11 @@ int cpio_parse_header(const struct cpio_header *archive, unsigned long len,
                       struct cpio_header_info *info)
 {
     const char *filename;
+    unsigned long fields[CPIO_NUM_FIELDS];
     unsigned long filesize;
     unsigned long filename_length;
+    unsigned long data_offset;
+    int has_check;
     const void *data;
     const struct cpio_header *next;
 
@@ -117,16 +204,24 @@ int cpio_parse_header(const struct cpio_header *archive, unsigned long len,
     }
 
     /* Ensure magic header exists. */
-    if (cpio_strncmp(archive->c_magic, CPIO_HEADER_MAGIC, sizeof(archive->c_magic)) != 0) {
+    if (cpio_strncmp(archive->c_magic, CPIO_HEADER_MAGIC, sizeof(archive->c_magic)) == 0) {
+        has_check = 0;
+    } else if (cpio_strncmp(archive->c_magic, CPIO_HEADER_MAGIC_CRC, sizeof(archive->c_magic)) == 0) {
+        has_check = 1;
+    } else {
         return -1;
     }
 
     /* Get filename and file size. */
-    filesize = parse_hex_str(archive->c_filesize, sizeof(archive->c_filesize));
-    filename_length = parse_hex_str(archive->c_namesize, sizeof(archive->c_namesize));
+    cpio_decode_header(archive, fields);
+    filesize = fields[CPIO_FIELD_FILESIZE];
+    filename_length = fields[CPIO_FIELD_NAMESIZE];
 
-    /* Ensure header + filename + file contents are accessible */
-    if (len < sizeof(struct cpio_header) + filename_length + filesize) {
+    /*
+     * Ensure the filename is accessible. The sizes come straight from the
+     * archive, so the checks are written such that they cannot overflow.
+     */
+    if (filename_length == 0 || filename_length > len - sizeof(struct cpio_header)) {
         return -1;
     }
 
@@ -145,21 +240,273 @@ int cpio_parse_header(const struct cpio_header *archive, unsigned long len,
     /* Find offset to data. */
     data = (void *) align_up((unsigned long) archive + sizeof(struct cpio_header) +
                              filename_length, CPIO_ALIGNMENT);
+
+    /* Ensure file contents, which follow the alignment padding, are accessible */
+    data_offset = (unsigned long) data - (unsigned long) archive;
+    if (filesize > 0 && (data_offset > len || filesize > len - data_offset)) {
+        return -1;
+    }
     next = (struct cpio_header *) align_up((unsigned long) data + filesize, CPIO_ALIGNMENT);
 
     if (info) {
         info->filename = filename;
         info->filesize = filesize;
+        info->mode = fields[CPIO_FIELD_MODE];
+        info->mtime = fields[CPIO_FIELD_MTIME];
+        info->ino = fields[CPIO_FIELD_INO];
+        info->nlink = fields[CPIO_FIELD_NLINK];
+        info->devmajor = fields[CPIO_FIELD_DEVMAJOR];
+        info->devminor = fields[CPIO_FIELD_DEVMINOR];
+        info->has_check = has_check;
+        info->check = fields[CPIO_FIELD_CHECK];
         info->data = data;
         info->next = next;
     }
     return 0;
 }
 
+/* Number of hash buckets used for 'file_count' files, keeping the load factor below 1/2. */
+static unsigned long cpio_index_num_buckets(unsigned long file_count)
+{
+    unsigned long buckets = 1;
+    while (buckets < file_count * 2) {
+        buckets *= 2;
+    }
+    return buckets;
+}
+
+/* Hash of inode and device numbers. */
+static unsigned int cpio_inode_hash_of(unsigned long ino, unsigned long devmajor, unsigned long devminor)
+{
+    unsigned int hash = ino;
+    hash = hash * 16777619u ^ devmajor;
+    hash = hash * 16777619u ^ devminor;
+    return hash * 2654435761u;
+}
+
+/* Hash of the inode and device numbers of an entry. */
+static unsigned int cpio_inode_hash(const struct cpio_header *header)
+{
+    return cpio_inode_hash_of(cpio_decode_field(header, CPIO_FIELD_INO),
+                              cpio_decode_field(header, CPIO_FIELD_DEVMAJOR),
+                              cpio_decode_field(header, CPIO_FIELD_DEVMINOR));
+}
+
+static int cpio_same_inode(const struct cpio_header *a, const struct cpio_header *b)
+{
+    return cpio_decode_field(a, CPIO_FIELD_INO) == cpio_decode_field(b, CPIO_FIELD_INO) &&
+           cpio_decode_field(a, CPIO_FIELD_DEVMAJOR) == cpio_decode_field(b, CPIO_FIELD_DEVMAJOR) &&
+           cpio_decode_field(a, CPIO_FIELD_DEVMINOR) == cpio_decode_field(b, CPIO_FIELD_DEVMINOR);
+}
+
+/* Non-zero if the header belongs to the inode of a parsed entry. */
+static int cpio_is_inode(const struct cpio_header *header, const struct cpio_header_info *info)
+{
+    return cpio_decode_field(header, CPIO_FIELD_INO) == info->ino &&
+           cpio_decode_field(header, CPIO_FIELD_DEVMAJOR) == info->devmajor &&
+           cpio_decode_field(header, CPIO_FIELD_DEVMINOR) == info->devminor;
+}
+
+void cpio_iter_init(cpio_iter_t *iter, const void *archive, unsigned long len)
+{
+    iter->archive = archive;
+    iter->len = len;
+    iter->links = NULL;
+    iter->links_mask = 0;
+    iter->links_count = 0;
+    iter->links_full = 0;
+    cpio_iter_reset(iter);
+}
+
+unsigned long cpio_iter_links_buf_size(unsigned int file_count)
+{
+    return cpio_index_num_buckets(file_count) * sizeof(const struct cpio_header *);
+}
+
+int cpio_iter_set_links(cpio_iter_t *iter, void *buf, unsigned long buf_len)
+{
+    unsigned long slots = 1;
+
+    if (buf == NULL || buf_len < sizeof(const struct cpio_header *)) {
+        return -1;
+    }
+    /* Largest power of two number of slots that fits */
+    while (slots * 2 <= buf_len / sizeof(const struct cpio_header *)) {
+        slots *= 2;
+    }
+    iter->links = buf;
+    iter->links_mask = slots - 1;
+    iter->links_count = 0;
+    iter->links_full = 0;
+    for (unsigned long i = 0; i < slots; i++) {
+        iter->links[i] = NULL;
+    }
+    /* Entries passed so far were not recorded. */
+    if (iter->header != iter->archive) {
+        iter->links_full = 1;
+    }
+    return 0;
+}
+
+/*
+ * Holders remembered by the link table stay valid across a reset, they are
+ * still the first holders of their inodes in archive order.
+ */
+void cpio_iter_reset(cpio_iter_t *iter)
+{
+    iter->header = iter->archive;
+    iter->remaining = iter->len;
+    iter->status = 0;
+}
+
+/* Advance the iterator, returning the raw header information. */
+static int cpio_iter_next_info(cpio_iter_t *iter, struct cpio_header_info *info)
+{
+    if (iter->status != 0) {
+        return iter->status;
+    }
+
+    int error = cpio_parse_header(iter->header, iter->remaining, info);
+    if (error) {
+        iter->status = error;
+        return error;
+    }
+    iter->remaining = cpio_len_next(iter->remaining, iter->header, info->next);
+    iter->header = info->next;
+    return 0;
+}
+
+/*
+ * Returns non-zero if the entry is a hard link whose data is stored with
+ * another entry of the same inode. Archivers store the data of a set of hard
+ * links only once, either with the first or the last entry of the set.
+ */
+static int cpio_is_link(unsigned long mode, unsigned long nlink, unsigned long filesize)
+{
+    return nlink > 1 && filesize == 0 && (mode & CPIO_MODE_TYPE) == CPIO_MODE_REG;
+}
+
+/* Returns non-zero if the entry holds the data of a set of hard links, as in cpio_index_resolve_links. */
+static int cpio_is_holder(const struct cpio_header_info *info)
+{
+    return info->nlink > 1 && info->filesize != 0 && (info->mode & CPIO_MODE_TYPE) == CPIO_MODE_REG;
+}
+
+/*
+ * Point a hard link entry at the data of the first entry of the same inode
+ * holding it, searching the entries starting at 'header'.
+ */
+static void cpio_resolve_link(const void *header, unsigned long len, struct cpio_header_info *info)
+{
+    cpio_iter_t iter;
+    struct cpio_header_info other;
+
+    cpio_iter_init(&iter, header, len);
+    while (cpio_iter_next_info(&iter, &other) == 0) {
+        if (cpio_is_holder(&other) && other.ino == info->ino &&
+            other.devmajor == info->devmajor && other.devminor == info->devminor) {
+            info->filesize = other.filesize;
+            info->data = other.data;
+            info->check = other.check;
+            return;
+        }
+    }
+}
+
+/* Resolve the data of a hard link, which rescans the archive, hence only do it for entries returned. */
+static void cpio_resolve_info(const void *archive, unsigned long len, struct cpio_header_info *info)
+{
+    if (cpio_is_link(info->mode, info->nlink, info->filesize)) {
+        cpio_resolve_link(archive, len, info);
+    }
+}
+
+/* Remember the first entry holding the data of each inode in the link table of an iterator. */
+static void cpio_iter_add_holder(cpio_iter_t *iter, const struct cpio_header *header,
+                                 const struct cpio_header_info *info)
+{
+    unsigned long slot = cpio_inode_hash_of(info->ino, info->devmajor, info->devminor) & iter->links_mask;
+
+    while (iter->links[slot] != NULL) {
+        if (cpio_is_inode(iter->links[slot], info)) {
+            return;
+        }
+        slot = (slot + 1) & iter->links_mask;
+    }
+    /* Keep the load factor at most 1/2, later links fall back to a rescan. */
+    if ((iter->links_count + 1) * 2 > iter->links_mask + 1) {
+        iter->links_full = 1;
+        return;
+    }
+    iter->links[slot] = header;
+    iter->links_count++;
+}
+
+/*
+ * Resolve a hard link returned by an iterator. With a complete link table,
+ * holders preceding the link are found in O(1), and holders following it,
+ * as written by archivers that store the data with the last link, by a
+ * search that only covers the rest of the archive.
+ */
+static void cpio_iter_resolve(cpio_iter_t *iter, struct cpio_header_info *info)
+{
+    if (!cpio_is_link(info->mode, info->nlink, info->filesize)) {
+        return;
+    }
+    if (iter->links == NULL) {
+        cpio_resolve_link(iter->archive, iter->len, info);
+        return;
+    }
+
+    unsigned long slot = cpio_inode_hash_of(info->ino, info->devmajor, info->devminor) & iter->links_mask;
+    while (iter->links[slot] != NULL) {
+        const struct cpio_header *holder = iter->links[slot];
+        if (cpio_is_inode(holder, info)) {
+            struct cpio_header_info other;
+            unsigned long offset = (const char *) holder - (const char *) iter->archive;
+            if (cpio_parse_header(holder, iter->len - offset, &other) == 0) {
+                info->filesize = other.filesize;
+                info->data = other.data;
+                info->check = other.check;
+            }
+            return;
+        }
+        slot = (slot + 1) & iter->links_mask;
+    }
+    if (iter->links_full) {
+        cpio_resolve_link(iter->archive, iter->len, info);
+    } else {
+        cpio_resolve_link(iter->header, iter->remaining, info);
+    }
+}
+
+int cpio_iter_next(cpio_iter_t *iter, struct cpio_entry *entry)
+{
+    struct cpio_header_info header_info;
+    const struct cpio_header *header = iter->header;
+
+    int error = cpio_iter_next_info(iter, &header_info);
+    if (error) {
+        return error;
+    }
+    if (iter->links != NULL && cpio_is_holder(&header_info)) {
+        cpio_iter_add_holder(iter, header, &header_info);
+    }
+    if (entry) {
+        cpio_iter_resolve(iter, &header_info);
+        entry->name = header_info.filename;
+        entry->size = header_info.filesize;
+        entry->mode = header_info.mode;
+        entry->mtime = header_info.mtime;
+        entry->data = header_info.data;
+    }
+    return 0;
+}
+
 /*
  * Get the location of the data in the n'th entry in the given archive file.
  *
- * We also return a pointer to the name of the file (not NUL terminated).
+ * We also return a pointer to the NUL terminated name of the file.
  *
  * Return NULL if the n'th entry doesn't exist.
  *
@@ -167,18 +514,21 @@ int cpio_parse_header(const struct cpio_header *archive, unsigned long len,
  */
 const void *cpio_get_entry(const void *archive, unsigned long len, int n, const char **name, unsigned long *size)
 {
-    const struct cpio_header *header = archive;
+    cpio_iter_t iter;
     struct cpio_header_info header_info;
 
+    if (n < 0) {
+        return NULL;
+    }
+
     /* Find n'th entry. */
+    cpio_iter_init(&iter, archive, len);
     for (int i = 0; i <= n; i++) {
-        int error = cpio_parse_header(header, len, &header_info);
-        if (error) {
+        if (cpio_iter_next_info(&iter, &header_info)) {
             return NULL;
         }
-        len = cpio_len_next(len, header, header_info.next);
-        header = header_info.next;
     }
+    cpio_resolve_info(archive, len, &header_info);
 
     if (name) {
         *name = header_info.filename;
@@ -199,33 +549,28 @@ const void *cpio_get_entry(const void *archive, unsigned long len, int n, const
  */
 const void *cpio_get_file(const void *archive, unsigned long len, const char *name, unsigned long *size)
 {
-    const struct cpio_header *header = archive;
+    cpio_iter_t iter;
     struct cpio_header_info header_info;
 
-    /* Find n'th entry. */
-    while (1) {
-        int error = cpio_parse_header(header, len, &header_info);
-        if (error) {
-            return NULL;
-        }
+    cpio_iter_init(&iter, archive, len);
+    while (cpio_iter_next_info(&iter, &header_info) == 0) {
         if (cpio_strncmp(header_info.filename, name, (unsigned long)(-1)) == 0) {
-            break;
+            cpio_resolve_info(archive, len, &header_info);
+            if (size) {
+                *size = header_info.filesize;
+            }
+            return header_info.data;
         }
-        len = cpio_len_next(len, header, header_info.next);
-        header = header_info.next;
     }
-
-    if (size) {
-        *size = header_info.filesize;
-    }
-    return header_info.data;
+    return NULL;
 }
 
 int cpio_info(const void *archive, unsigned long len, struct cpio_info *info)
 {
-    const struct cpio_header *header;
-    unsigned long current_path_sz;
+    cpio_iter_t iter;
     struct cpio_header_info header_info;
+    unsigned long current_path_sz;
+    int error;
 
     if (info == NULL) {
         return 1;
@@ -233,18 +578,9 @@ int cpio_info(const void *archive, unsigned long len, struct cpio_info *info)
     info->file_count = 0;
     info->max_path_sz = 0;
 
-    header = archive;
-    while (1) {
-        int error = cpio_parse_header(header, len, &header_info);
-        if (error == -1) {
-            return error;
-        } else if (error == 1) {
-            /* EOF */
-            break;
-        }
+    cpio_iter_init(&iter, archive, len);
+    while ((error = cpio_iter_next_info(&iter, &header_info)) == 0) {
         info->file_count++;
-        len = cpio_len_next(len, header, header_info.next);
-        header = header_info.next;
 
         // Check if this is the maximum file path size.
         current_path_sz = cpio_strlen(header_info.filename);
@@ -253,23 +589,484 @@ int cpio_info(const void *archive, unsigned long len, struct cpio_info *info)
         }
     }
 
-    return 0;
+    /* 1 is EOF */
+    return error == 1 ? 0 : error;
 }
 
 void cpio_ls(const void *archive, unsigned long len, char **buf, unsigned long buf_len)
 {
-    const struct cpio_header *header;
+    cpio_iter_t iter;
     struct cpio_header_info header_info;
 
-    header = archive;
+    cpio_iter_init(&iter, archive, len);
     for (unsigned long i = 0; i < buf_len; i++) {
-        int error = cpio_parse_header(header, len, &header_info);
         // Break on an error or nothing left to read.
-        if (error) {
+        if (cpio_iter_next_info(&iter, &header_info)) {
             break;
         }
         cpio_strcpy(buf[i], header_info.filename);
-        len = cpio_len_next(len, header, header_info.next);
-        header = header_info.next;
     }
 }
+
+/* FNV-1a hash of a NULL terminated string. */
+static unsigned int cpio_hash(const char *str)
+{
+    unsigned int hash = 2166136261u;
+    for (; *str; str++) {
+        hash ^= (unsigned char) *str;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+unsigned long cpio_index_buf_size(unsigned int file_count)
+{
+    return file_count * sizeof(cpio_index_entry_t) +
+           cpio_index_num_buckets(file_count) * sizeof(unsigned int);
+}
+
+/* Fill in an index entry from a parsed header. */
+static void cpio_index_fill_entry(cpio_index_entry_t *entry, const struct cpio_header *header,
+                                  const struct cpio_header_info *header_info)
+{
+    entry->header = header;
+    entry->name = header_info->filename;
+    entry->data = header_info->data;
+    entry->size = header_info->filesize;
+    entry->hash = cpio_hash(header_info->filename);
+    entry->check = header_info->check;
+    entry->check_state = header_info->has_check ? CPIO_CHECK_PENDING : CPIO_CHECK_NONE;
+}
+
+/*
+ * Verify the checksum of an entry if the verification mode of the index asks
+ * for it. The result is cached in the entry, so the data of an entry is summed
+ * at most once.
+ */
+static int cpio_index_entry_ok(const cpio_index_t *index, cpio_index_entry_t *entry)
+{
+    if (index->verify == CPIO_VERIFY_OFF) {
+        return 1;
+    }
+    if (entry->check_state == CPIO_CHECK_PENDING) {
+        entry->check_state = cpio_checksum(entry->data, entry->size) == entry->check ?
+                             CPIO_CHECK_OK : CPIO_CHECK_BAD;
+    }
+    return entry->check_state != CPIO_CHECK_BAD;
+}
+
+/*
+ * Point hard link entries at the data of the entry of the same inode holding
+ * it. The hash table memory is used temporarily to map inodes to entries.
+ */
+static void cpio_index_resolve_links(cpio_index_entry_t *entries, unsigned int count,
+                                     unsigned int *buckets, unsigned int mask)
+{
+    unsigned int links = 0;
+
+    for (unsigned int i = 0; i <= mask; i++) {
+        buckets[i] = 0;
+    }
+    for (unsigned int i = 0; i < count; i++) {
+        const struct cpio_header *header = entries[i].header;
+        if (cpio_decode_field(header, CPIO_FIELD_NLINK) <= 1 ||
+            (cpio_decode_field(header, CPIO_FIELD_MODE) & CPIO_MODE_TYPE) != CPIO_MODE_REG) {
+            continue;
+        }
+        if (entries[i].size == 0) {
+            links++;
+            continue;
+        }
+        unsigned int slot = cpio_inode_hash(header) & mask;
+        while (buckets[slot] != 0 && !cpio_same_inode(entries[buckets[slot] - 1].header, header)) {
+            slot = (slot + 1) & mask;
+        }
+        if (buckets[slot] == 0) {
+            buckets[slot] = i + 1;
+        }
+    }
+    if (links == 0) {
+        return;
+    }
+
+    for (unsigned int i = 0; i < count; i++) {
+        const struct cpio_header *header = entries[i].header;
+        if (!cpio_is_link(cpio_decode_field(header, CPIO_FIELD_MODE),
+                          cpio_decode_field(header, CPIO_FIELD_NLINK), entries[i].size)) {
+            continue;
+        }
+        unsigned int slot = cpio_inode_hash(header) & mask;
+        while (buckets[slot] != 0) {
+            const cpio_index_entry_t *target = &entries[buckets[slot] - 1];
+            if (cpio_same_inode(target->header, header)) {
+                entries[i].data = target->data;
+                entries[i].size = target->size;
+                entries[i].check = target->check;
+                entries[i].check_state = target->check_state == CPIO_CHECK_NONE ?
+                                         CPIO_CHECK_NONE : CPIO_CHECK_PENDING;
+                break;
+            }
+            slot = (slot + 1) & mask;
+        }
+    }
+}
+
+/*
+ * Build the hash table directly behind the dense array and publish the index.
+ * The table needs space even for an empty archive.
+ */
+static int cpio_index_finish(cpio_index_t *index, cpio_index_entry_t *entries, unsigned int count,
+                             unsigned int max_path_sz, unsigned long buf_len)
+{
+    if (cpio_index_buf_size(count) > buf_len) {
+        return -1;
+    }
+
+    unsigned int *buckets = (unsigned int *) &entries[count];
+    unsigned int mask = cpio_index_num_buckets(count) - 1;
+
+    cpio_index_resolve_links(entries, count, buckets, mask);
+
+    for (unsigned int i = 0; i <= mask; i++) {
+        buckets[i] = 0;
+    }
+    for (unsigned int i = 0; i < count; i++) {
+        unsigned int slot = entries[i].hash & mask;
+        while (buckets[slot] != 0) {
+            const cpio_index_entry_t *other = &entries[buckets[slot] - 1];
+            if (other->hash == entries[i].hash &&
+                cpio_strncmp(other->name, entries[i].name, (unsigned long)(-1)) == 0) {
+                /* Duplicate name, the first one wins as in cpio_get_file. */
+                break;
+            }
+            slot = (slot + 1) & mask;
+        }
+        if (buckets[slot] == 0) {
+            buckets[slot] = i + 1;
+        }
+    }
+
+    index->entries = entries;
+    index->file_count = count;
+    index->max_path_sz = max_path_sz;
+    index->buckets = buckets;
+    index->bucket_mask = mask;
+    index->verify = CPIO_VERIFY_OFF;
+    return 0;
+}
+
+int cpio_index_init(cpio_index_t *index, const void *archive, unsigned long len,
+                    void *buf, unsigned long buf_len)
+{
+    cpio_iter_t iter;
+    struct cpio_header_info header_info;
+    cpio_index_entry_t *entries = buf;
+    unsigned int count = 0;
+    unsigned int max_path_sz = 0;
+
+    if (index == NULL || buf == NULL) {
+        return -1;
+    }
+
+    /* Single pass over the archive, filling in the dense array. */
+    cpio_iter_init(&iter, archive, len);
+    while (1) {
+        const struct cpio_header *header = iter.header;
+        int error = cpio_iter_next_info(&iter, &header_info);
+        if (error == -1) {
+            return error;
+        } else if (error == 1) {
+            /* EOF */
+            break;
+        }
+        if (cpio_index_buf_size(count + 1) > buf_len) {
+            return -1;
+        }
+        cpio_index_fill_entry(&entries[count], header, &header_info);
+        count++;
+
+        unsigned int path_sz = cpio_strlen(header_info.filename);
+        if (path_sz > max_path_sz) {
+            max_path_sz = path_sz;
+        }
+    }
+
+    return cpio_index_finish(index, entries, count, max_path_sz, buf_len);
+}
+
+/*
+ * A header found by a speculative scan. Candidates may also be bytes in file
+ * data that happen to look like a header, the serial pass only ever consumes
+ * candidates that are on the chain of headers starting at the archive base.
+ */
+struct cpio_candidate {
+    cpio_index_entry_t entry;
+    const struct cpio_header *next;
+    unsigned int path_sz;
+    int status;
+};
+
+/* Per task bookkeeping, the candidates of a task follow in the scratch memory. */
+struct cpio_scan_task {
+    struct cpio_candidate *candidates;
+    unsigned long capacity;
+    unsigned long count;
+    /* Position of the serial pass within the candidates */
+    unsigned long cursor;
+};
+
+struct cpio_scan {
+    const char *archive;
+    unsigned long len;
+    unsigned long chunk_len;
+    struct cpio_scan_task *tasks;
+};
+
+/* Smallest possible entry: a header and a single NULL byte name, aligned. */
+#define CPIO_MIN_ENTRY_SZ ((sizeof(struct cpio_header) + 1 + CPIO_ALIGNMENT - 1) & ~(CPIO_ALIGNMENT - 1))
+
+/* Length of the archive chunk scanned by one task, a multiple of the alignment. */
+static unsigned long cpio_scan_chunk_len(unsigned long len, unsigned int num_tasks)
+{
+    return align_up((len + num_tasks - 1) / num_tasks, CPIO_ALIGNMENT);
+}
+
+unsigned long cpio_index_scratch_size(unsigned long len, unsigned int num_tasks)
+{
+    if (num_tasks == 0) {
+        return 0;
+    }
+    unsigned long per_task = cpio_scan_chunk_len(len, num_tasks) / CPIO_MIN_ENTRY_SZ + 1;
+    return num_tasks * (sizeof(struct cpio_scan_task) + per_task * sizeof(struct cpio_candidate));
+}
+
+/*
+ * Scan one chunk of the archive for aligned header magics and speculatively
+ * parse every candidate. This is the part of index construction that runs in
+ * parallel, each task only writes to its own part of the scratch memory.
+ */
+static void cpio_scan_chunk(void *arg, unsigned int task)
+{
+    struct cpio_scan *scan = arg;
+    struct cpio_scan_task *t = &scan->tasks[task];
+    const char *end = scan->archive + scan->len;
+    const char *pos = scan->archive + (unsigned long) task * scan->chunk_len;
+    const char *chunk_end = pos + scan->chunk_len;
+    struct cpio_header_info header_info;
+
+    t->count = 0;
+    if (pos >= end) {
+        return;
+    }
+    if (chunk_end > end || chunk_end < pos) {
+        chunk_end = end;
+    }
+    pos = (const char *) align_up((unsigned long) pos, CPIO_ALIGNMENT);
+
+    for (; pos < chunk_end && t->count < t->capacity; pos += CPIO_ALIGNMENT) {
+        if ((unsigned long)(end - pos) < sizeof(struct cpio_header)) {
+            break;
+        }
+        /* Cheap test of the leading magic bytes before parsing. */
+        if (pos[0] != '0' || pos[1] != '7' || pos[2] != '0' || pos[3] != '7') {
+            continue;
+        }
+        const struct cpio_header *header = (const struct cpio_header *) pos;
+        int status = cpio_parse_header(header, end - pos, &header_info);
+        if (status == -1) {
+            continue;
+        }
+
+        struct cpio_candidate *c = &t->candidates[t->count++];
+        c->status = status;
+        c->entry.header = header;
+        if (status == 0) {
+            cpio_index_fill_entry(&c->entry, header, &header_info);
+            c->next = header_info.next;
+            c->path_sz = cpio_strlen(header_info.filename);
+        }
+    }
+}
+
+/* Find a candidate for the given header, advancing the per task cursor. */
+static struct cpio_candidate *cpio_scan_find(struct cpio_scan *scan, const struct cpio_header *header)
+{
+    unsigned long offset = (const char *) header - scan->archive;
+    struct cpio_scan_task *t = &scan->tasks[offset / scan->chunk_len];
+
+    while (t->cursor < t->count && t->candidates[t->cursor].entry.header < header) {
+        t->cursor++;
+    }
+    if (t->cursor < t->count && t->candidates[t->cursor].entry.header == header) {
+        return &t->candidates[t->cursor];
+    }
+    return NULL;
+}
+
+int cpio_index_init_parallel(cpio_index_t *index, const void *archive, unsigned long len,
+                             void *buf, unsigned long buf_len, void *scratch, unsigned long scratch_len,
+                             unsigned int num_tasks, cpio_run_tasks_fn run, void *cookie)
+{
+    struct cpio_scan scan;
+    cpio_index_entry_t *entries = buf;
+    unsigned int count = 0;
+    unsigned int max_path_sz = 0;
+
+    if (index == NULL || buf == NULL || run == NULL || scratch == NULL) {
+        return -1;
+    }
+    if (num_tasks == 0 || scratch_len < cpio_index_scratch_size(len, num_tasks)) {
+        return -1;
+    }
+
+    scan.archive = archive;
+    scan.len = len;
+    scan.chunk_len = cpio_scan_chunk_len(len, num_tasks);
+    if (scan.chunk_len == 0) {
+        return cpio_index_init(index, archive, len, buf, buf_len);
+    }
+    scan.tasks = scratch;
+    struct cpio_candidate *candidates = (struct cpio_candidate *) &scan.tasks[num_tasks];
+    unsigned long per_task = scan.chunk_len / CPIO_MIN_ENTRY_SZ + 1;
+    for (unsigned int i = 0; i < num_tasks; i++) {
+        scan.tasks[i].candidates = &candidates[i * per_task];
+        scan.tasks[i].capacity = per_task;
+        scan.tasks[i].count = 0;
+        scan.tasks[i].cursor = 0;
+    }
+
+    run(cookie, cpio_scan_chunk, &scan, num_tasks);
+
+    /*
+     * Serial pass following the chain of headers. Headers that were not found
+     * speculatively, e.g. because a task ran out of space for candidates, are
+     * parsed here, so the result is identical to the serial cpio_index_init.
+     */
+    const struct cpio_header *header = archive;
+    unsigned long remaining = len;
+    while (1) {
+        struct cpio_candidate local;
+        struct cpio_candidate *c = NULL;
+        unsigned long offset = (const char *) header - scan.archive;
+
+        if (offset < len) {
+            c = cpio_scan_find(&scan, header);
+        }
+        if (c == NULL) {
+            struct cpio_header_info header_info;
+            c = &local;
+            c->status = cpio_parse_header(header, remaining, &header_info);
+            if (c->status == 0) {
+                cpio_index_fill_entry(&c->entry, header, &header_info);
+                c->next = header_info.next;
+                c->path_sz = cpio_strlen(header_info.filename);
+            }
+        }
+
+        if (c->status == -1) {
+            return -1;
+        } else if (c->status == 1) {
+            /* EOF */
+            break;
+        }
+        if (cpio_index_buf_size(count + 1) > buf_len) {
+            return -1;
+        }
+        entries[count++] = c->entry;
+        if (c->path_sz > max_path_sz) {
+            max_path_sz = c->path_sz;
+        }
+        remaining = cpio_len_next(remaining, header, c->next);
+        header = c->next;
+    }
+
+    return cpio_index_finish(index, entries, count, max_path_sz, buf_len);
+}
+
+const void *cpio_index_get_entry(cpio_index_t *index, int n, const char **name, unsigned long *size)
+{
+    if (n < 0 || (unsigned int) n >= index->file_count) {
+        return NULL;
+    }
+
+    cpio_index_entry_t *entry = &index->entries[n];
+    if (!cpio_index_entry_ok(index, entry)) {
+        return NULL;
+    }
+    if (name) {
+        *name = entry->name;
+    }
+    if (size) {
+        *size = entry->size;
+    }
+    return entry->data;
+}
+
+const void *cpio_index_get_file(cpio_index_t *index, const char *name, unsigned long *size)
+{
+    unsigned int hash = cpio_hash(name);
+    unsigned int slot = hash & index->bucket_mask;
+
+    while (index->buckets[slot] != 0) {
+        cpio_index_entry_t *entry = &index->entries[index->buckets[slot] - 1];
+        if (entry->hash == hash && cpio_strncmp(entry->name, name, (unsigned long)(-1)) == 0) {
+            if (!cpio_index_entry_ok(index, entry)) {
+                return NULL;
+            }
+            if (size) {
+                *size = entry->size;
+            }
+            return entry->data;
+        }
+        slot = (slot + 1) & index->bucket_mask;
+    }
+    return NULL;
+}
+
+unsigned int cpio_checksum(const void *data, unsigned long len)
+{
+    const unsigned char *p = data;
+    unsigned int sum = 0;
+
+    /*
+     * Sum 8 bytes at a time into four 16-bit lanes. Each step adds at most
+     * 2 * 255 to a lane, so the lanes are folded every 128 steps before they
+     * can overflow.
+     */
+    while (len >= 8) {
+        unsigned long long acc = 0;
+        unsigned long steps = len / 8;
+        if (steps > 128) {
+            steps = 128;
+        }
+        len -= steps * 8;
+        for (; steps > 0; steps--, p += 8) {
+            unsigned long long x;
+            __builtin_memcpy(&x, p, sizeof(x));
+            acc += x & 0x00ff00ff00ff00ffull;
+            acc += (x >> 8) & 0x00ff00ff00ff00ffull;
+        }
+        acc = (acc & 0x0000ffff0000ffffull) + ((acc >> 16) & 0x0000ffff0000ffffull);
+        sum += (unsigned int) acc + (unsigned int)(acc >> 32);
+    }
+    for (; len > 0; len--, p++) {
+        sum += *p;
+    }
+    return sum;
+}
+
+int cpio_index_set_verify(cpio_index_t *index, enum cpio_verify_mode mode)
+{
+    int error = 0;
+
+    index->verify = mode;
+    if (mode != CPIO_VERIFY_EAGER) {
+        return 0;
+    }
+    for (unsigned int i = 0; i < index->file_count; i++) {
+        if (!cpio_index_entry_ok(index, &index->entries[i])) {
+            error = -1;
+        }
+    }
+    return error;
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright 2026, agent
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <cpio/cpio.h>
+
+/*
+ * Header field decoders shared between the library and its host checks. They
+ * are not part of the public interface.
+ */
+
+/* Indices of the hex encoded fields following the magic of a cpio_header. */
+enum cpio_field {
+    CPIO_FIELD_INO,
+    CPIO_FIELD_MODE,
+    CPIO_FIELD_UID,
+    CPIO_FIELD_GID,
+    CPIO_FIELD_NLINK,
+    CPIO_FIELD_MTIME,
+    CPIO_FIELD_FILESIZE,
+    CPIO_FIELD_DEVMAJOR,
+    CPIO_FIELD_DEVMINOR,
+    CPIO_FIELD_RDEVMAJOR,
+    CPIO_FIELD_RDEVMINOR,
+    CPIO_FIELD_NAMESIZE,
+    CPIO_FIELD_CHECK,
+    CPIO_NUM_FIELDS
+};
+
+#define CPIO_FIELD_LEN 8
+#define SWAR_ONES 0x0101010101010101ull
+#define SWAR_HIGH 0x8080808080808080ull
+
+/* Parse an ASCII hex string into an integer, stopping at the first non-hex character. */
+unsigned long cpio_parse_hex_str(const char *s, unsigned int max_len);
+
+/* Load 8 characters, the first one ending up in the least significant byte. */
+unsigned long long cpio_swar_load(const char *s);
+
+/* Returns a mask with the high bit of every byte set which holds a hex digit. */
+unsigned long long cpio_swar_hex_mask(unsigned long long x);
+
+/* Decode all hex fields of a header, with the semantics of cpio_parse_hex_str. */
+void cpio_decode_header(const struct cpio_header *header, unsigned long fields[CPIO_NUM_FIELDS]);
+
+/* Decode a single hex field of a header. */
+unsigned long cpio_decode_field(const struct cpio_header *header, enum cpio_field field);
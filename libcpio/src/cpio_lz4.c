@@ -0,0 +1,202 @@
+/*
+ * Copyright 2026, agent
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/*
+ * Freestanding decoder of LZ4 blocks. The only dependency is memcpy, which
+ * compilers expand inline for the fixed size copies used here.
+ */
+
+#include <cpio/cpio.h>
+
+#ifndef NULL
+#define NULL ((void *)0)
+#endif
+
+#define LZ4_SIZE_PREFIX 4
+#define LZ4_MIN_MATCH 4
+#define LZ4_RUN_MASK 15
+
+int cpio_lz4_is_compressed(const char *name)
+{
+    const char suffix[] = CPIO_LZ4_SUFFIX;
+    unsigned long name_len = 0;
+    unsigned long suffix_len = sizeof(suffix) - 1;
+
+    while (name[name_len] != 0) {
+        name_len++;
+    }
+    if (name_len < suffix_len) {
+        return 0;
+    }
+    for (unsigned long i = 0; i < suffix_len; i++) {
+        if (name[name_len - suffix_len + i] != suffix[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+long cpio_lz4_size(const void *data, unsigned long size)
+{
+    const unsigned char *p = data;
+    if (size < LZ4_SIZE_PREFIX) {
+        return -1;
+    }
+    return (long)((unsigned long) p[0] | (unsigned long) p[1] << 8 |
+                  (unsigned long) p[2] << 16 | (unsigned long) p[3] << 24);
+}
+
+/*
+ * Read an extended length, i.e. a sequence of bytes that are added to the
+ * length as long as they are 255. Returns -1 if the input ends early.
+ */
+static int lz4_read_length(const unsigned char **ip, const unsigned char *iend, unsigned long *len)
+{
+    unsigned char b;
+    do {
+        if (*ip >= iend) {
+            return -1;
+        }
+        b = *(*ip)++;
+        *len += b;
+    } while (b == 255);
+    return 0;
+}
+
+/* Decode a raw LZ4 block, returning the decompressed size or -1. */
+static long lz4_decode_block(const unsigned char *ip, const unsigned char *iend,
+                             unsigned char *op, unsigned char *oend)
+{
+    unsigned char *ostart = op;
+
+    while (ip < iend) {
+        unsigned char token = *ip++;
+
+        /* Literals */
+        unsigned long lit = token >> 4;
+        if (lit == LZ4_RUN_MASK && lz4_read_length(&ip, iend, &lit)) {
+            return -1;
+        }
+        if (lit > (unsigned long)(iend - ip) || lit > (unsigned long)(oend - op)) {
+            return -1;
+        }
+        __builtin_memcpy(op, ip, lit);
+        ip += lit;
+        op += lit;
+
+        /* The last sequence only has literals. */
+        if (ip == iend) {
+            break;
+        }
+
+        /* Match */
+        if (iend - ip < 2) {
+            return -1;
+        }
+        unsigned long offset = ip[0] | (unsigned long) ip[1] << 8;
+        ip += 2;
+        if (offset == 0 || offset > (unsigned long)(op - ostart)) {
+            return -1;
+        }
+        unsigned long len = token & LZ4_RUN_MASK;
+        if (len == LZ4_RUN_MASK && lz4_read_length(&ip, iend, &len)) {
+            return -1;
+        }
+        len += LZ4_MIN_MATCH;
+        if (len > (unsigned long)(oend - op)) {
+            return -1;
+        }
+
+        const unsigned char *match = op - offset;
+        if (offset >= len) {
+            __builtin_memcpy(op, match, len);
+            op += len;
+        } else if (offset >= 8) {
+            /* Overlapping, but every 8 byte chunk is complete before it is read. */
+            while (len >= 8) {
+                __builtin_memcpy(op, match, 8);
+                op += 8;
+                match += 8;
+                len -= 8;
+            }
+            while (len-- > 0) {
+                *op++ = *match++;
+            }
+        } else {
+            while (len-- > 0) {
+                *op++ = *match++;
+            }
+        }
+    }
+    return op - ostart;
+}
+
+long cpio_lz4_decompress(const void *data, unsigned long size, void *buf, unsigned long buf_len)
+{
+    long out_size = cpio_lz4_size(data, size);
+    if (out_size < 0 || (unsigned long) out_size > buf_len) {
+        return -1;
+    }
+
+    const unsigned char *ip = (const unsigned char *) data + LZ4_SIZE_PREFIX;
+    unsigned char *op = buf;
+    long decoded = lz4_decode_block(ip, ip + (size - LZ4_SIZE_PREFIX), op, op + out_size);
+    if (decoded != out_size) {
+        return -1;
+    }
+    return decoded;
+}
+
+int cpio_lz4_cache_init(cpio_lz4_cache_t *cache, void *buf, unsigned long buf_len)
+{
+    if (cache == NULL || buf == NULL) {
+        return -1;
+    }
+
+    cache->slot_size = buf_len / CPIO_LZ4_CACHE_SLOTS;
+    cache->clock = 0;
+    for (int i = 0; i < CPIO_LZ4_CACHE_SLOTS; i++) {
+        cache->slots[i].key = NULL;
+        cache->slots[i].buf = (char *) buf + i * cache->slot_size;
+        cache->slots[i].size = 0;
+        cache->slots[i].last_use = 0;
+    }
+    return 0;
+}
+
+const void *cpio_lz4_cache_get(cpio_lz4_cache_t *cache, const void *data, unsigned long size,
+                               unsigned long *out_size)
+{
+    int victim = 0;
+
+    cache->clock++;
+    for (int i = 0; i < CPIO_LZ4_CACHE_SLOTS; i++) {
+        if (cache->slots[i].key == data) {
+            cache->slots[i].last_use = cache->clock;
+            if (out_size) {
+                *out_size = cache->slots[i].size;
+            }
+            return cache->slots[i].buf;
+        }
+        if (cache->slots[i].last_use < cache->slots[victim].last_use) {
+            victim = i;
+        }
+    }
+
+    /* Miss, replace the least recently used slot. */
+    cache->slots[victim].key = NULL;
+    long decoded = cpio_lz4_decompress(data, size, cache->slots[victim].buf, cache->slot_size);
+    if (decoded < 0) {
+        return NULL;
+    }
+    cache->slots[victim].key = data;
+    cache->slots[victim].size = decoded;
+    cache->slots[victim].last_use = cache->clock;
+    if (out_size) {
+        *out_size = decoded;
+    }
+    return cache->slots[victim].buf;
+}
@@ -0,0 +1,233 @@
+/*
+ * Copyright 2026, agent
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <cpio/cpio.h>
+
+#ifndef NULL
+#define NULL ((void *)0)
+#endif
+
+/* Name of the n'th entry in name order. */
+#define PATH_NAME(paths, n) ((paths)->index->entries[(paths)->order[n]].name)
+
+static unsigned long cpio_strlen(const char *str)
+{
+    const char *s;
+    for (s = str; *s; ++s) {}
+    return (s - str);
+}
+
+static int cpio_strcmp(const char *a, const char *b)
+{
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return (unsigned char) *a - (unsigned char) *b;
+}
+
+/*
+ * Compare the first 'len' characters of a name with a prefix. Returns 0 if
+ * the name starts with the prefix, the sign gives the order otherwise. This
+ * is consistent with the order of full names, so all names sharing a prefix
+ * form a contiguous range.
+ */
+static int cpio_prefix_cmp(const char *name, const char *prefix, unsigned long len)
+{
+    for (unsigned long i = 0; i < len; i++) {
+        if (name[i] != prefix[i]) {
+            return (unsigned char) name[i] - (unsigned char) prefix[i];
+        }
+    }
+    return 0;
+}
+
+/* First position in name order whose name compares >= (or > if 'upper') to the prefix. */
+static unsigned int cpio_paths_bound(const cpio_paths_t *paths, const char *prefix, unsigned long len, int upper)
+{
+    unsigned int lo = 0;
+    unsigned int hi = paths->count;
+
+    while (lo < hi) {
+        unsigned int mid = lo + (hi - lo) / 2;
+        int cmp = cpio_prefix_cmp(PATH_NAME(paths, mid), prefix, len);
+        if (cmp < 0 || (upper && cmp == 0)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/* Returns non-zero if an entry is named exactly by the first 'len' characters of 'name'. */
+static int cpio_paths_exists(const cpio_paths_t *paths, const char *name, unsigned long len)
+{
+    /* An exact match sorts before all other names sharing the prefix. */
+    unsigned int pos = cpio_paths_bound(paths, name, len, 0);
+    return pos < paths->count && cpio_prefix_cmp(PATH_NAME(paths, pos), name, len) == 0 &&
+           PATH_NAME(paths, pos)[len] == 0;
+}
+
+static void cpio_paths_sift_down(unsigned int *order, const cpio_index_entry_t *entries,
+                                 unsigned int root, unsigned int count)
+{
+    while (2 * root + 1 < count) {
+        unsigned int child = 2 * root + 1;
+        if (child + 1 < count &&
+            cpio_strcmp(entries[order[child]].name, entries[order[child + 1]].name) < 0) {
+            child++;
+        }
+        if (cpio_strcmp(entries[order[root]].name, entries[order[child]].name) >= 0) {
+            return;
+        }
+        unsigned int tmp = order[root];
+        order[root] = order[child];
+        order[child] = tmp;
+        root = child;
+    }
+}
+
+unsigned long cpio_paths_buf_size(const cpio_index_t *index)
+{
+    return index->file_count * sizeof(unsigned int);
+}
+
+int cpio_paths_init(cpio_paths_t *paths, cpio_index_t *index, void *buf, unsigned long buf_len)
+{
+    unsigned int *order = buf;
+    unsigned int count = index->file_count;
+
+    if (paths == NULL || (buf == NULL && count != 0) || buf_len < cpio_paths_buf_size(index)) {
+        return -1;
+    }
+
+    /* Heap sort, as it neither allocates nor recurses. */
+    for (unsigned int i = 0; i < count; i++) {
+        order[i] = i;
+    }
+    for (unsigned int i = count / 2; i > 0; i--) {
+        cpio_paths_sift_down(order, index->entries, i - 1, count);
+    }
+    for (unsigned int end = count; end > 1; end--) {
+        unsigned int tmp = order[0];
+        order[0] = order[end - 1];
+        order[end - 1] = tmp;
+        cpio_paths_sift_down(order, index->entries, 0, end - 1);
+    }
+
+    paths->index = index;
+    paths->order = order;
+    paths->count = count;
+    return 0;
+}
+
+const cpio_index_entry_t *cpio_paths_get(const cpio_paths_t *paths, unsigned int n)
+{
+    if (n >= paths->count) {
+        return NULL;
+    }
+    return &paths->index->entries[paths->order[n]];
+}
+
+void cpio_paths_prefix(const cpio_paths_t *paths, const char *prefix, unsigned int *first, unsigned int *count)
+{
+    unsigned long len = cpio_strlen(prefix);
+    unsigned int lo = cpio_paths_bound(paths, prefix, len, 0);
+    unsigned int hi = cpio_paths_bound(paths, prefix, len, 1);
+
+    if (first) {
+        *first = lo;
+    }
+    if (count) {
+        *count = hi - lo;
+    }
+}
+
+int cpio_paths_list_dir(const cpio_paths_t *paths, const char *dir, cpio_path_fn fn, void *cookie)
+{
+    unsigned long len = cpio_strlen(dir);
+    unsigned int pos = cpio_paths_bound(paths, dir, len, 0);
+    unsigned int end = cpio_paths_bound(paths, dir, len, 1);
+
+    while (pos < end) {
+        const char *name = PATH_NAME(paths, pos);
+        unsigned long child_len = len;
+        while (name[child_len] != 0 && name[child_len] != '/') {
+            child_len++;
+        }
+
+        int ret = 0;
+        if (name[child_len] == 0) {
+            /* A child with an entry of its own, but not the directory itself. */
+            if (child_len > len) {
+                ret = fn(cookie, name, child_len, &paths->index->entries[paths->order[pos]]);
+            }
+            pos++;
+        } else {
+            /* A child directory, skip everything below it. */
+            if (child_len > len && !cpio_paths_exists(paths, name, child_len)) {
+                ret = fn(cookie, name, child_len, NULL);
+            }
+            pos = cpio_paths_bound(paths, name, child_len + 1, 1);
+        }
+        if (ret) {
+            return ret;
+        }
+    }
+    return 0;
+}
+
+/* Match a name against a glob pattern, with backtracking to the last '*'. */
+static int cpio_glob_match(const char *pattern, const char *name)
+{
+    const char *star = NULL;
+    const char *star_name = NULL;
+
+    while (*name) {
+        if (*pattern == '*') {
+            star = ++pattern;
+            star_name = name;
+        } else if (*name != '/' && (*pattern == '?' || *pattern == *name)) {
+            pattern++;
+            name++;
+        } else if (*name == '/' && *pattern == '/') {
+            pattern++;
+            name++;
+            /* A '*' never matches across a '/'. */
+            star = NULL;
+        } else if (star && *star_name != '/') {
+            pattern = star;
+            name = ++star_name;
+        } else {
+            return 0;
+        }
+    }
+    while (*pattern == '*') {
+        pattern++;
+    }
+    return *pattern == 0;
+}
+
+int cpio_paths_glob(const cpio_paths_t *paths, const char *pattern, cpio_path_fn fn, void *cookie)
+{
+    unsigned long len = 0;
+    while (pattern[len] != 0 && pattern[len] != '*' && pattern[len] != '?') {
+        len++;
+    }
+
+    unsigned int end = cpio_paths_bound(paths, pattern, len, 1);
+    for (unsigned int pos = cpio_paths_bound(paths, pattern, len, 0); pos < end; pos++) {
+        const char *name = PATH_NAME(paths, pos);
+        if (cpio_glob_match(pattern + len, name + len)) {
+            int ret = fn(cookie, name, cpio_strlen(name), &paths->index->entries[paths->order[pos]]);
+            if (ret) {
+                return ret;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,327 @@
+/*
+ * Copyright 2026, agent
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <cpio/cpio.h>
+
+#ifndef NULL
+#define NULL ((void *)0)
+#endif
+
+#define CPIO_FIELD_LEN 8
+#define CPIO_FIELD_MAX 0xffffffffUL
+
+/* Source of padding bytes. */
+static const char cpio_zeros[64];
+
+/* Align 'n' up to the value 'align', which must be a power of two. */
+static unsigned long align_up(unsigned long n, unsigned long align)
+{
+    return (n + align - 1) & (~(align - 1));
+}
+
+static unsigned long cpio_strlen(const char *str)
+{
+    const char *s;
+    for (s = str; *s; ++s) {}
+    return (s - str);
+}
+
+/* Format 'value' as 8 lower case hex digits. */
+static void format_hex(char *s, unsigned long value)
+{
+    static const char digits[] = "0123456789abcdef";
+    for (int i = CPIO_FIELD_LEN - 1; i >= 0; i--) {
+        s[i] = digits[value & 0xf];
+        value >>= 4;
+    }
+}
+
+static int cpio_writer_emit(cpio_writer_t *writer, const void *buf, unsigned long len)
+{
+    if (len == 0) {
+        return 0;
+    }
+    if (writer->write(writer->cookie, buf, len)) {
+        writer->error = -1;
+        return -1;
+    }
+    writer->offset += len;
+    return 0;
+}
+
+static int cpio_writer_pad(cpio_writer_t *writer, unsigned long len)
+{
+    while (len > 0) {
+        unsigned long chunk = len < sizeof(cpio_zeros) ? len : sizeof(cpio_zeros);
+        if (cpio_writer_emit(writer, cpio_zeros, chunk)) {
+            return -1;
+        }
+        len -= chunk;
+    }
+    return 0;
+}
+
+/*
+ * Write a header and name, padding the name with NULL characters such that
+ * the data following it starts at the given alignment.
+ */
+static int cpio_writer_header(cpio_writer_t *writer, const char *name, unsigned long data_align,
+                              unsigned long ino, unsigned long mode, unsigned long nlink,
+                              unsigned long mtime, unsigned long filesize, unsigned long check)
+{
+    struct cpio_header header;
+    unsigned long name_len = cpio_strlen(name) + 1;
+    unsigned long name_start = writer->offset + sizeof(header);
+    unsigned long data_start = align_up(name_start + name_len, data_align);
+    unsigned long namesize = name_len;
+
+    if (data_align > CPIO_ALIGNMENT) {
+        /* The reader places data at the next CPIO_ALIGNMENT boundary after the name. */
+        namesize = data_start - name_start;
+    }
+    if (namesize > CPIO_FIELD_MAX || filesize > CPIO_FIELD_MAX) {
+        writer->error = -1;
+        return -1;
+    }
+
+    const char *magic = (writer->flags & CPIO_WRITER_CRC) ? CPIO_HEADER_MAGIC_CRC : CPIO_HEADER_MAGIC;
+    for (unsigned int i = 0; i < sizeof(header.c_magic); i++) {
+        header.c_magic[i] = magic[i];
+    }
+    format_hex(header.c_ino, ino);
+    format_hex(header.c_mode, mode);
+    format_hex(header.c_uid, 0);
+    format_hex(header.c_gid, 0);
+    format_hex(header.c_nlink, nlink);
+    format_hex(header.c_mtime, mtime);
+    format_hex(header.c_filesize, filesize);
+    format_hex(header.c_devmajor, 0);
+    format_hex(header.c_devminor, 0);
+    format_hex(header.c_rdevmajor, 0);
+    format_hex(header.c_rdevminor, 0);
+    format_hex(header.c_namesize, namesize);
+    format_hex(header.c_check, check);
+
+    if (cpio_writer_emit(writer, &header, sizeof(header)) ||
+        cpio_writer_emit(writer, name, name_len)) {
+        return -1;
+    }
+    return cpio_writer_pad(writer, align_up(writer->offset + namesize - name_len, CPIO_ALIGNMENT) - writer->offset);
+}
+
+int cpio_writer_init(cpio_writer_t *writer, cpio_write_fn write, void *cookie,
+                     unsigned long data_align, unsigned int flags)
+{
+    if (writer == NULL || write == NULL || (data_align & (data_align - 1)) != 0) {
+        return -1;
+    }
+    if (data_align < CPIO_ALIGNMENT) {
+        data_align = CPIO_ALIGNMENT;
+    }
+
+    writer->write = write;
+    writer->cookie = cookie;
+    writer->offset = 0;
+    writer->data_align = data_align;
+    writer->ino = 1;
+    writer->flags = flags;
+    writer->error = 0;
+    return 0;
+}
+
+/* Write an entry with the given inode number and link count. */
+static int cpio_writer_add_entry(cpio_writer_t *writer, const char *name, unsigned int mode,
+                                 unsigned long mtime, unsigned long ino, unsigned long nlink,
+                                 const struct cpio_iovec *iov, unsigned int iovcnt)
+{
+    unsigned long filesize = 0;
+    unsigned int check = 0;
+
+    if (writer->error) {
+        return writer->error;
+    }
+
+    for (unsigned int i = 0; i < iovcnt; i++) {
+        filesize += iov[i].len;
+        if (writer->flags & CPIO_WRITER_CRC) {
+            check += cpio_checksum(iov[i].base, iov[i].len);
+        }
+    }
+
+    /* Entries without data, e.g. hard links, need no padding. */
+    unsigned long data_align = filesize ? writer->data_align : CPIO_ALIGNMENT;
+    if (cpio_writer_header(writer, name, data_align, ino, mode, nlink, mtime, filesize, check)) {
+        return -1;
+    }
+
+    for (unsigned int i = 0; i < iovcnt; i++) {
+        if (cpio_writer_emit(writer, iov[i].base, iov[i].len)) {
+            return -1;
+        }
+    }
+    return cpio_writer_pad(writer, align_up(writer->offset, CPIO_ALIGNMENT) - writer->offset);
+}
+
+int cpio_writer_add(cpio_writer_t *writer, const char *name, unsigned int mode, unsigned long mtime,
+                    const struct cpio_iovec *iov, unsigned int iovcnt)
+{
+    return cpio_writer_add_entry(writer, name, mode, mtime, writer->ino++, 1, iov, iovcnt);
+}
+
+int cpio_writer_finish(cpio_writer_t *writer)
+{
+    if (writer->error) {
+        return writer->error;
+    }
+    return cpio_writer_header(writer, CPIO_FOOTER_MAGIC, CPIO_ALIGNMENT, 0, 0, 1, 0, 0, 0);
+}
+
+/* Number of hash buckets used for 'max_files' files, keeping the load factor below 1/2. */
+static unsigned long cpio_builder_num_buckets(unsigned long max_files)
+{
+    unsigned long buckets = 1;
+    while (buckets < max_files * 2) {
+        buckets *= 2;
+    }
+    return buckets;
+}
+
+/* FNV-1a hash over the data of a file. */
+static unsigned long long cpio_content_hash(const struct cpio_iovec *iov, unsigned int iovcnt)
+{
+    unsigned long long hash = 14695981039346656037ull;
+    for (unsigned int i = 0; i < iovcnt; i++) {
+        const unsigned char *p = iov[i].base;
+        for (unsigned long j = 0; j < iov[i].len; j++) {
+            hash ^= p[j];
+            hash *= 1099511628211ull;
+        }
+    }
+    return hash;
+}
+
+/* Compare the data of two files of equal size, given as lists of pieces. */
+static int cpio_content_equal(const struct cpio_iovec *a, unsigned int acnt,
+                              const struct cpio_iovec *b, unsigned int bcnt)
+{
+    unsigned int ai = 0, bi = 0;
+    unsigned long aoff = 0, boff = 0;
+
+    while (ai < acnt && bi < bcnt) {
+        if (aoff == a[ai].len) {
+            ai++;
+            aoff = 0;
+            continue;
+        }
+        if (boff == b[bi].len) {
+            bi++;
+            boff = 0;
+            continue;
+        }
+        const unsigned char *pa = (const unsigned char *) a[ai].base + aoff;
+        const unsigned char *pb = (const unsigned char *) b[bi].base + boff;
+        unsigned long n = a[ai].len - aoff < b[bi].len - boff ? a[ai].len - aoff : b[bi].len - boff;
+        if (pa != pb) {
+            for (unsigned long i = 0; i < n; i++) {
+                if (pa[i] != pb[i]) {
+                    return 0;
+                }
+            }
+        }
+        aoff += n;
+        boff += n;
+    }
+    return 1;
+}
+
+unsigned long cpio_builder_buf_size(unsigned int max_files)
+{
+    return max_files * sizeof(struct cpio_builder_entry) +
+           cpio_builder_num_buckets(max_files) * sizeof(unsigned int);
+}
+
+int cpio_builder_init(cpio_builder_t *builder, unsigned int max_files, void *buf, unsigned long buf_len)
+{
+    if (builder == NULL || buf == NULL || buf_len < cpio_builder_buf_size(max_files)) {
+        return -1;
+    }
+
+    builder->entries = buf;
+    builder->count = 0;
+    builder->max_files = max_files;
+    builder->buckets = (unsigned int *) &builder->entries[max_files];
+    builder->bucket_mask = cpio_builder_num_buckets(max_files) - 1;
+    for (unsigned int i = 0; i <= builder->bucket_mask; i++) {
+        builder->buckets[i] = 0;
+    }
+    return 0;
+}
+
+int cpio_builder_add(cpio_builder_t *builder, const char *name, unsigned int mode, unsigned long mtime,
+                     const struct cpio_iovec *iov, unsigned int iovcnt)
+{
+    if (builder->count == builder->max_files) {
+        return -1;
+    }
+
+    struct cpio_builder_entry *entry = &builder->entries[builder->count];
+    entry->name = name;
+    entry->mode = mode;
+    entry->mtime = mtime;
+    entry->iov = iov;
+    entry->iovcnt = iovcnt;
+    entry->size = 0;
+    for (unsigned int i = 0; i < iovcnt; i++) {
+        entry->size += iov[i].len;
+    }
+    entry->link = 0;
+    entry->nlink = 1;
+    entry->ino = 0;
+
+    /* Only non-empty regular files are candidates for sharing their data. */
+    if (entry->size == 0 || (mode & CPIO_MODE_TYPE) != CPIO_MODE_REG) {
+        builder->count++;
+        return 0;
+    }
+
+    entry->hash = cpio_content_hash(iov, iovcnt);
+    unsigned int slot = entry->hash & builder->bucket_mask;
+    while (builder->buckets[slot] != 0) {
+        struct cpio_builder_entry *other = &builder->entries[builder->buckets[slot] - 1];
+        if (other->hash == entry->hash && other->size == entry->size &&
+            cpio_content_equal(other->iov, other->iovcnt, iov, iovcnt)) {
+            entry->link = builder->buckets[slot];
+            other->nlink++;
+            builder->count++;
+            return 0;
+        }
+        slot = (slot + 1) & builder->bucket_mask;
+    }
+    builder->buckets[slot] = ++builder->count;
+    return 0;
+}
+
+int cpio_builder_finish(cpio_builder_t *builder, cpio_writer_t *writer)
+{
+    for (unsigned int i = 0; i < builder->count; i++) {
+        struct cpio_builder_entry *entry = &builder->entries[i];
+        int error;
+        if (entry->link) {
+            /* The data is stored with the first entry, this is a hard link to it. */
+            const struct cpio_builder_entry *target = &builder->entries[entry->link - 1];
+            error = cpio_writer_add_entry(writer, entry->name, entry->mode, entry->mtime,
+                                          target->ino, target->nlink, NULL, 0);
+        } else {
+            entry->ino = writer->ino++;
+            error = cpio_writer_add_entry(writer, entry->name, entry->mode, entry->mtime,
+                                          entry->ino, entry->nlink, entry->iov, entry->iovcnt);
+        }
+        if (error) {
+            return error;
+        }
+    }
+    return cpio_writer_finish(writer);
+}
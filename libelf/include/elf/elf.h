@@ -32,10 +32,13 @@ ELF file into memory.
 #include <stdint.h>
 #include <elf.h>
 
+struct elf_section_index;
+
 struct elf {
     void const *elfFile;
     size_t elfSize;
     unsigned char elfClass; /* 32-bit or 64-bit */
+    struct elf_section_index *sectionIndex; /* optional, see elf_newSectionIndex */
 };
 typedef struct elf elf_t;
 
@@ -45,6 +48,79 @@ enum elf_addr_type {
 };
 typedef enum elf_addr_type elf_addr_type_t;
 
+/**
+ * A program header, independent of the class of the ELF file.
+ */
+typedef struct elf_phdr {
+    uint32_t type;
+    uint32_t flags;
+    size_t offset;
+    uintptr_t vaddr;
+    uintptr_t paddr;
+    size_t file_size;
+    size_t mem_size;
+    size_t align;
+} elf_phdr_t;
+
+/**
+ * An entry of the dynamic section, independent of the class of the ELF file.
+ */
+typedef struct elf_dyn {
+    int64_t tag;
+    uint64_t value;
+} elf_dyn_t;
+
+/**
+ * Map whole pages of file data at a destination address.
+ *
+ * @param cookie Cookie of the loader
+ * @param dest Page aligned destination address
+ * @param src Page aligned location of the data within the ELF file
+ * @param len Length in bytes, a multiple of the page size
+ * @param flags Flags of the program header (PF_R, PF_W, PF_X)
+ *
+ * \return 0 on success, otherwise < 0
+ */
+typedef int (*elf_load_map_fn_t)(void *cookie, uintptr_t dest, const void *src, size_t len, uint32_t flags);
+
+/**
+ * Copy file data to a destination address.
+ *
+ * @param cookie Cookie of the loader
+ * @param dest Destination address
+ * @param src Location of the data within the ELF file
+ * @param len Length in bytes, never crossing a page boundary at dest
+ * @param flags Flags of the program header (PF_R, PF_W, PF_X)
+ *
+ * \return 0 on success, otherwise < 0
+ */
+typedef int (*elf_load_copy_fn_t)(void *cookie, uintptr_t dest, const void *src, size_t len, uint32_t flags);
+
+/**
+ * Zero memory at a destination address.
+ *
+ * @param cookie Cookie of the loader
+ * @param dest Destination address
+ * @param len Length in bytes. Either a part of a single page, or a range of
+ *            whole pages starting at a page aligned dest.
+ * @param flags Flags of the program header (PF_R, PF_W, PF_X)
+ *
+ * \return 0 on success, otherwise < 0
+ */
+typedef int (*elf_load_zero_fn_t)(void *cookie, uintptr_t dest, size_t len, uint32_t flags);
+
+/**
+ * Operations used by elf_loadSegments. Any of the functions may be NULL: if
+ * map is NULL the data is copied instead, if copy is NULL memcpy is used and
+ * if zero is NULL memset is used.
+ */
+typedef struct elf_loader {
+    void *cookie;
+    elf_load_map_fn_t map;
+    elf_load_copy_fn_t copy;
+    elf_load_zero_fn_t zero;
+} elf_loader_t;
+
 /* ELF header functions */
 /**
  * Initialises an elf_t structure and checks that the ELF file is valid.
@@ -125,6 +201,24 @@ int elf_checkSectionTable(const elf_t *elfFile);
  */
 uintptr_t elf_getEntryPoint(const elf_t *elfFile);
 
+/**
+ * Get the type of an ELF file.
+ *
+ * @param elfFile Pointer to a valid ELF structure
+ *
+ * \return The type (ET_EXEC, ET_DYN, ...).
+ */
+uint16_t elf_getType(const elf_t *elfFile);
+
+/**
+ * Get the machine an ELF file is built for.
+ *
+ * @param elfFile Pointer to a valid ELF structure
+ *
+ * \return The machine (EM_X86_64, EM_AARCH64, ...).
+ */
+uint16_t elf_getMachine(const elf_t *elfFile);
+
 /**
  * Determine number of program headers in an ELF file.
  *
@@ -194,6 +288,31 @@ const void *elf_getSection(const elf_t *elfFile, size_t i);
  */
 const void *elf_getSectionNamed(const elf_t *elfFile, const char *str, size_t *i);
 
+/**
+ * Determine the size of the buffer elf_newSectionIndex needs for an ELF file.
+ *
+ * @param elfFile Pointer to a valid ELF structure
+ *
+ * \return The size in bytes.
+ */
+size_t elf_getSectionIndexSize(const elf_t *elfFile);
+
+/**
+ * Attach a hash index of the section names to an ELF structure, which
+ * elf_getSectionNamed then uses instead of comparing the name of every
+ * section. The index is built now if eager is set, otherwise on the first
+ * call of elf_getSectionNamed; building it lazily is not thread safe.
+ *
+ * @param elfFile Pointer to a valid ELF structure
+ * @param buf Buffer for the index, pointer aligned, which must stay valid as
+ *            long as elfFile is used
+ * @param size Size of buf, at least elf_getSectionIndexSize
+ * @param eager Whether to build the index immediately
+ *
+ * \return 0 on success, otherwise < 0
+ */
+int elf_newSectionIndex(elf_t *elfFile, void *buf, size_t size, bool eager);
+
 /**
  * Return the name of a given section.
  *
@@ -309,6 +428,47 @@ size_t elf_getSectionEntrySize(const elf_t *elfFile, size_t i);
 
 /* Program header functions */
 
+/**
+ * Decode a range of program headers into a class independent form. The class
+ * of the ELF file is only checked once rather than for every field, so this is
+ * the preferred way to loop over the program header table.
+ *
+ * @param elf Pointer to a valid ELF structure
+ * @param first Index of the first program header to decode
+ * @param phdrs Array to store the decoded program headers
+ * @param count Maximum number of program headers to decode
+ *
+ * \return The number of program headers decoded, 0 once first is past the end.
+ */
+size_t elf_getProgramHeaders(const elf_t *elf, size_t first, elf_phdr_t *phdrs, size_t count);
+
+/**
+ * Find the file data of the PT_LOAD segment containing a virtual address.
+ *
+ * @param elf Pointer to a valid ELF structure
+ * @param vaddr Virtual address
+ * @param size Pointer to store the number of bytes of file data from vaddr
+ *             to the end of the segment's file data
+ *
+ * \return Pointer to the data at vaddr, or NULL if vaddr is not in the file
+ *         data of a PT_LOAD segment.
+ */
+const void *elf_getVaddrData(const elf_t *elf, uintptr_t vaddr, size_t *size);
+
+/**
+ * Decode a range of the entries of the dynamic section (PT_DYNAMIC) into a
+ * class independent form.
+ *
+ * @param elf Pointer to a valid ELF structure
+ * @param first Index of the first entry to decode
+ * @param dyn Array to store the decoded entries
+ * @param count Maximum number of entries to decode
+ *
+ * \return The number of entries decoded, which is 0 once first reaches the
+ *         DT_NULL entry or the end of the dynamic section, or if there is none.
+ */
+size_t elf_getDynamicEntries(const elf_t *elf, size_t first, elf_dyn_t *dyn, size_t count);
+
 /**
  * Return the segment data for a given program header.
  *
@@ -447,3 +607,537 @@ uintptr_t elf_vtopProgramHeader(const elf_t *elfFile, size_t ph, uintptr_t vaddr
  *
  */
 int elf_loadFile(const elf_t *elfFile, elf_addr_type_t addr_type);
+
+/**
+ * Read part of an ELF file that is not resident in memory.
+ *
+ * @param cookie Cookie passed to elf_loadStream
+ * @param offset Offset in the ELF file
+ * @param buf Buffer to read into
+ * @param len Number of bytes to read
+ *
+ * \return 0 if all len bytes were read, otherwise < 0
+ */
+typedef int (*elf_read_fn_t)(void *cookie, size_t offset, void *buf, size_t len);
+
+/**
+ * Load an ELF file into memory without holding the whole file in memory
+ *
+ * @param read Function to read the ELF file
+ * @param cookie Cookie passed to read
+ * @param size Size of the ELF file
+ * @param addr_type If PHYSICAL load using the physical address, otherwise using the
+ *                  virtual addresses
+ * @param entry Pointer to store the entry point, may be NULL
+ *
+ * \return 0 on success, otherwise < 0
+ *
+ * The ELF header and program headers are read and checked first. Then each
+ * PT_LOAD segment is read straight to its destination, in program header
+ * order, and the rest of the segment is zeroed. Like elf_loadFile, this
+ * assumes direct access to the destination addresses. No section headers
+ * are read.
+ */
+int elf_loadStream(elf_read_fn_t read, void *cookie, size_t size, elf_addr_type_t addr_type, uintptr_t *entry);
+
+/**
+ * Load the PT_LOAD segments of an ELF file with page granularity
+ *
+ * @param elf Pointer to a valid ELF structure
+ * @param addr_type If PHYSICAL load using the physical address, otherwise using the
+ *                  virtual addresses
+ * @param page_size The page size, a power of two
+ * @param loader The operations used to place the segments
+ *
+ * \return 0 on success, otherwise < 0
+ *
+ * Only PT_LOAD segments are loaded, in program header order. Each segment is
+ * split into pages: whole pages of file data whose destination and source are
+ * both page aligned are passed to the map operation, so they can be mapped
+ * directly out of the ELF file. All other file data is passed to the copy
+ * operation one page at a time. The remainder of the last file page and the pages beyond
+ * the file data, i.e. the BSS, are passed to the zero operation, with all
+ * whole BSS pages of a segment in a single call.
+ */
+int elf_loadSegments(const elf_t *elf, elf_addr_type_t addr_type, size_t page_size,
+                     const elf_loader_t *loader);
+
+
+/* Hash functions */
+
+#define ELF_SHA256_BLOCK_SIZE 64
+#define ELF_SHA256_DIGEST_SIZE 32
+
+/**
+ * State of a SHA-256 computation.
+ */
+typedef struct elf_sha256 {
+    uint32_t state[8];
+    uint64_t length;
+    uint8_t buf[ELF_SHA256_BLOCK_SIZE];
+    size_t buf_len;
+} elf_sha256_t;
+
+/**
+ * Start a SHA-256 computation.
+ *
+ * @param ctx elf_sha256_t to initialise
+ */
+void elf_sha256Init(elf_sha256_t *ctx);
+
+/**
+ * Add data to a SHA-256 computation.
+ *
+ * @param ctx Pointer to a started SHA-256 computation
+ * @param data Data to hash
+ * @param len Length of data in bytes
+ */
+void elf_sha256Update(elf_sha256_t *ctx, const void *data, size_t len);
+
+/**
+ * Finish a SHA-256 computation.
+ *
+ * @param ctx Pointer to a started SHA-256 computation
+ * @param digest Buffer to store the digest
+ */
+void elf_sha256Final(elf_sha256_t *ctx, uint8_t digest[ELF_SHA256_DIGEST_SIZE]);
+
+/**
+ * Load the PT_LOAD segments of an ELF file like elf_loadSegments, and hash
+ * them in the same pass.
+ *
+ * @param elf Pointer to a valid ELF structure
+ * @param addr_type If PHYSICAL load using the physical address, otherwise using the
+ *                  virtual addresses
+ * @param page_size The page size, a power of two
+ * @param loader The operations used to place the segments
+ * @param segment_digests Array to store the digest of each PT_LOAD segment, may be NULL
+ * @param max_segments Number of elements in segment_digests
+ * @param image_digest Buffer to store the digest of the image, may be NULL
+ *
+ * \return 0 on success, otherwise < 0, also if there are more than
+ *         max_segments PT_LOAD segments
+ *
+ * The digest of a segment is the SHA-256 of its file data, which is hashed
+ * one page at a time right after that page is placed. The image digest is the
+ * SHA-256 of, for each PT_LOAD segment in order, its load address and memory
+ * size as 64-bit and its flags as 32-bit little endian integers followed by
+ * the digest of the segment. It thus also covers the layout of the image,
+ * including the zeroed part of each segment.
+ */
+int elf_loadSegmentsHashed(const elf_t *elf, elf_addr_type_t addr_type, size_t page_size,
+                           const elf_loader_t *loader, uint8_t (*segment_digests)[ELF_SHA256_DIGEST_SIZE],
+                           size_t max_segments, uint8_t image_digest[ELF_SHA256_DIGEST_SIZE]);
+
+
+/* Page layout functions */
+
+/**
+ * A range of the loaded image and the largest page size that can back it.
+ *
+ * If a larger page size is available, promote_size is the next larger one
+ * and promote_padding is how many bytes of padding around the range would
+ * let it be backed by pages of that size. promote_relink is set if only a
+ * linker can insert that padding, because neighbouring segments would have
+ * to move or the alignment of the segment does not allow pages of that size.
+ * promote_size is 0 if there is no larger page size.
+ */
+typedef struct elf_page_range {
+    uintptr_t start;
+    size_t size;
+    size_t page_size;
+    uint32_t flags;         /* PF_R, PF_W, PF_X */
+    size_t promote_size;
+    size_t promote_padding;
+    bool promote_relink;
+} elf_page_range_t;
+
+/**
+ * Plan which pages could back the loadable segments of an ELF file, for
+ * example 4 KiB pages and 2 MiB or 1 GiB large pages or block mappings.
+ *
+ * Each segment is split into ranges in address order, using the largest page
+ * sizes its alignment and size allow. A segment only uses page sizes for which
+ * its file offset is congruent to its address, so that the file can be mapped,
+ * and, in relocatable (ET_DYN) files, that do not exceed its p_align, as the
+ * image is only placed at a multiple of that. Pages that neighbouring segments
+ * share get ranges of their own in the smallest page size, as they need the
+ * permissions of both segments, so those ranges may overlap.
+ *
+ * @param elf Pointer to a valid ELF structure
+ * @param addr_type If PHYSICAL use the physical addresses, otherwise the
+ *                  virtual addresses
+ * @param page_sizes Available page sizes, increasing powers of two
+ * @param num_page_sizes Number of page sizes
+ * @param ranges Array to store the ranges in
+ * @param max_ranges Size of the array, the ranges after it are not stored
+ *
+ * \return The number of ranges of the layout, which may be more than
+ *         max_ranges. 0 if there is nothing to load or an argument is invalid.
+ */
+size_t elf_getPageLayout(const elf_t *elf, elf_addr_type_t addr_type, const size_t *page_sizes,
+                         size_t num_page_sizes, elf_page_range_t *ranges, size_t max_ranges);
+
+
+/* Load plan functions */
+
+#define ELF_LOAD_PLAN_MAGIC 0x4e4c5045 /* "EPLN" */
+#define ELF_LOAD_PLAN_VERSION 1
+
+/* The image may be placed at a base other than the one it was linked at */
+#define ELF_LOAD_PLAN_RELOCATABLE (1 << 0)
+
+enum elf_load_op_type {
+    ELF_LOAD_OP_PAGES,  /* pages of the image and their permissions */
+    ELF_LOAD_OP_COPY,   /* copy file data to the image */
+    ELF_LOAD_OP_ZERO,   /* zero part of the image */
+};
+
+/**
+ * An operation of a load plan. Addresses are offsets from the base of the
+ * image, source offsets are offsets in the ELF file.
+ */
+typedef struct elf_load_op {
+    uint64_t dest;
+    uint64_t src;       /* ELF_LOAD_OP_COPY only */
+    uint64_t len;
+    uint32_t type;      /* enum elf_load_op_type */
+    uint32_t flags;     /* PF_R, PF_W, PF_X */
+} elf_load_op_t;
+
+/**
+ * How to load an ELF file, computed once by elf_newLoadPlan and applied any
+ * number of times by elf_applyLoadPlan.
+ *
+ * The plan starts with the page ranges of the image in address order, with
+ * merged permissions where segments share a page, followed by the copy and
+ * zero ranges, merged where they are contiguous. All fields have a fixed
+ * size, so a plan of elf_getLoadPlanLength bytes can be stored and loaded
+ * by other tools, in the byte order of the machine that created it.
+ */
+typedef struct elf_load_plan {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t flags;
+    uint32_t num_ops;
+    uint64_t base;      /* page aligned address the image is linked at */
+    uint64_t size;      /* size of the image in whole pages */
+    uint64_t entry;
+    uint64_t page_size;
+    elf_load_op_t ops[];
+} elf_load_plan_t;
+
+/**
+ * Determine the size of the buffer elf_newLoadPlan needs at most.
+ *
+ * @param elf Pointer to a valid ELF structure
+ *
+ * \return The size in bytes.
+ */
+size_t elf_getLoadPlanSize(const elf_t *elf);
+
+/**
+ * Compute the load plan of an ELF file.
+ *
+ * @param elf Pointer to a valid ELF structure
+ * @param addr_type If PHYSICAL plan using the physical address, otherwise using the
+ *                  virtual addresses
+ * @param page_size The page size, a power of two
+ * @param plan Buffer for the plan, 8 byte aligned
+ * @param size Size of the buffer, see elf_getLoadPlanSize
+ *
+ * \return 0 on success, otherwise < 0
+ */
+int elf_newLoadPlan(const elf_t *elf, elf_addr_type_t addr_type, size_t page_size, elf_load_plan_t *plan,
+                    size_t size);
+
+/**
+ * Determine the number of bytes of a load plan in use, e.g. to store it.
+ *
+ * @param plan Pointer to a valid load plan
+ *
+ * \return The size in bytes.
+ */
+size_t elf_getLoadPlanLength(const elf_load_plan_t *plan);
+
+/**
+ * Check that a load plan read from elsewhere is well formed and fits the ELF
+ * file it is applied to. Plans created by elf_newLoadPlan need no checking.
+ *
+ * @param plan Potential load plan
+ * @param size Number of bytes of the plan
+ * @param file_size Size of the ELF file
+ *
+ * \return 0 on success, otherwise < 0
+ */
+int elf_checkLoadPlan(const elf_load_plan_t *plan, size_t size, size_t file_size);
+
+/**
+ * Apply a load plan. The page ranges of the plan are not acted on; the
+ * caller should set the pages up before, and may apply the permissions
+ * after. Copies and zero ranges are passed to the loader as described for
+ * elf_loadSegments.
+ *
+ * @param plan Pointer to a valid load plan
+ * @param file The ELF file the plan was computed for
+ * @param base Address to load the image at, page aligned. Other than plan->base
+ *             only if the plan has the ELF_LOAD_PLAN_RELOCATABLE flag, in which
+ *             case the image usually needs elf_relocate afterwards.
+ * @param loader The operations used to place the data
+ *
+ * \return 0 on success, otherwise < 0
+ */
+int elf_applyLoadPlan(const elf_load_plan_t *plan, const void *file, uintptr_t base, const elf_loader_t *loader);
+
+
+/* Symbol functions */
+
+/**
+ * A symbol of an ELF file. The name points into the string table of the ELF
+ * file and is not copied.
+ */
+typedef struct elf_symbol {
+    const char *name;
+    uintptr_t value;
+    size_t size;
+    size_t index;        /* index in the symbol table */
+    uint16_t shndx;      /* section index, or SHN_* */
+    unsigned char type;  /* STT_* */
+    unsigned char bind;  /* STB_* */
+} elf_symbol_t;
+
+/* Which symbols an elf_symtab_t covers */
+enum elf_symtab_scope {
+    ELF_SYMTAB_ALL,         /* .symtab, or the dynamic symbols if there is none */
+    ELF_SYMTAB_DYNAMIC,     /* the dynamic symbols, i.e. .dynsym */
+};
+typedef enum elf_symtab_scope elf_symtab_scope_t;
+
+/* How an elf_symtab_t finds a symbol by name */
+enum elf_symtab_hash {
+    ELF_SYMTAB_GNU_HASH,    /* DT_GNU_HASH table of the ELF file */
+    ELF_SYMTAB_SYSV_HASH,   /* DT_HASH table of the ELF file */
+    ELF_SYMTAB_INDEX,       /* index built by elf_newSymbolTable */
+};
+
+/**
+ * A symbol table of an ELF file together with a hash table to look up
+ * symbols by name. Everything except the index built for ELF files without
+ * a hash table points into the ELF file.
+ */
+typedef struct elf_symtab {
+    const elf_t *elf;
+    enum elf_symtab_hash hash;
+    const void *symbols;
+    size_t sym_size;
+    size_t num_symbols;
+    const char *strings;
+    size_t strings_size;
+    /* Hash table, either from the ELF file or the index */
+    uint32_t num_buckets;
+    const uint32_t *buckets;
+    const uint32_t *chain;
+    /* GNU hash table only */
+    uint32_t sym_offset;
+    uint32_t bloom_size;
+    uint32_t bloom_shift;
+    const void *bloom;
+} elf_symtab_t;
+
+/**
+ * Determine the size of the buffer elf_newSymbolTable needs for an ELF file.
+ *
+ * @param elf Pointer to a valid ELF structure
+ * @param scope Which symbols the symbol table covers
+ *
+ * \return The size in bytes, 0 if the ELF file has a hash table that is used
+ *         directly, or if it has no symbol table.
+ */
+size_t elf_getSymbolIndexSize(const elf_t *elf, elf_symtab_scope_t scope);
+
+/**
+ * Initialise a symbol table for looking up the symbols of an ELF file.
+ *
+ * With ELF_SYMTAB_ALL an index of .symtab is built in buf, so that local
+ * symbols such as static functions and, in executables, main can be found.
+ * ELF files without .symtab, e.g. stripped ones, are treated as with
+ * ELF_SYMTAB_DYNAMIC.
+ *
+ * With ELF_SYMTAB_DYNAMIC only the dynamic symbol table is used, which the
+ * dynamic linker needs. If the dynamic section has a GNU hash table
+ * (DT_GNU_HASH) it is used directly, otherwise a SysV hash table (DT_HASH).
+ * If there is no hash table, an index of .dynsym is built in buf.
+ *
+ * @param elf Pointer to a valid ELF structure, which must stay valid while
+ *            the symbol table is used
+ * @param scope Which symbols the symbol table covers
+ * @param buf Buffer for the index, 4 byte aligned, may be NULL if
+ *            elf_getSymbolIndexSize returns 0
+ * @param buf_size Size of buf
+ * @param res elf_symtab_t to initialise
+ *
+ * \return 0 on success, otherwise < 0
+ */
+int elf_newSymbolTable(const elf_t *elf, elf_symtab_scope_t scope, void *buf, size_t buf_size, elf_symtab_t *res);
+
+/**
+ * Get the number of symbols in a symbol table.
+ *
+ * @param symtab Pointer to a valid symbol table
+ *
+ * \return The number of symbols, including the null symbol at index 0.
+ */
+size_t elf_getNumSymbols(const elf_symtab_t *symtab);
+
+/**
+ * Get a symbol of a symbol table by index.
+ *
+ * @param symtab Pointer to a valid symbol table
+ * @param i Index of the symbol
+ * @param sym Pointer to store the symbol
+ *
+ * \return 0 on success, otherwise < 0
+ */
+int elf_getSymbol(const elf_symtab_t *symtab, size_t i, elf_symbol_t *sym);
+
+/**
+ * Look up a defined symbol by name using the hash table of a symbol table.
+ * If several symbols have the same name, the one with the lowest index is
+ * returned for an index; for hash tables of the ELF file the order of the
+ * hash chain decides.
+ *
+ * @param symtab Pointer to a valid symbol table
+ * @param name Name of the symbol
+ * @param sym Pointer to store the symbol
+ *
+ * \return 0 if the symbol was found, otherwise < 0
+ */
+int elf_lookupSymbol(const elf_symtab_t *symtab, const char *name, elf_symbol_t *sym);
+
+
+/* Symbolizer functions */
+
+/**
+ * The address range of a function in an ELF file, with the offset of its name
+ * in the string table of the ELF file.
+ */
+typedef struct elf_symbolizer_range {
+    uintptr_t start;
+    uint32_t size;
+    uint32_t name;
+} elf_symbolizer_range_t;
+
+/**
+ * An ELF file added to a symbolizer. Its ranges are ranges[first] to
+ * ranges[first + count - 1] of the symbolizer, sorted by address.
+ */
+typedef struct elf_symbolizer_image {
+    const char *strings;
+    size_t first;
+    size_t count;
+} elf_symbolizer_image_t;
+
+/**
+ * Resolves addresses to functions for a number of ELF files, such as one per
+ * component. Each ELF file has its own address space, and the names are not
+ * copied out of the string tables of the ELF files, so the ELF files must stay
+ * in memory while the symbolizer is used.
+ */
+typedef struct elf_symbolizer {
+    elf_symbolizer_image_t *images;
+    size_t max_images;
+    size_t num_images;
+    elf_symbolizer_range_t *ranges;
+    size_t max_ranges;
+    size_t num_ranges;
+} elf_symbolizer_t;
+
+/**
+ * Initialise an empty symbolizer.
+ *
+ * @param symbolizer elf_symbolizer_t to initialise
+ * @param images Array to hold the images
+ * @param max_images Number of elements in images
+ * @param ranges Array to hold the function ranges of all images
+ * @param max_ranges Number of elements in ranges, see elf_getSymbolizerRanges
+ */
+void elf_symbolizerInit(elf_symbolizer_t *symbolizer, elf_symbolizer_image_t *images, size_t max_images,
+                        elf_symbolizer_range_t *ranges, size_t max_ranges);
+
+/**
+ * Determine the number of ranges elf_symbolizerAddImage needs at most for an
+ * ELF file, which is the number of defined function symbols.
+ *
+ * @param elf Pointer to a valid ELF structure
+ *
+ * \return The number of ranges.
+ */
+size_t elf_getSymbolizerRanges(const elf_t *elf);
+
+/**
+ * Add the function symbols of .symtab, or .dynsym if there is no .symtab, of
+ * an ELF file to a symbolizer. Of several functions at the same address only
+ * one is kept, and functions without a size extend to the next function. The
+ * Thumb bit of ARM function symbols is cleared from their start address.
+ *
+ * @param symbolizer Pointer to a valid symbolizer
+ * @param elf Pointer to a valid ELF structure
+ * @param image Pointer to store the index of the image, may be NULL
+ *
+ * \return 0 on success, otherwise < 0 if there is no symbol table or the
+ *         symbolizer is full
+ */
+int elf_symbolizerAddImage(elf_symbolizer_t *symbolizer, const elf_t *elf, size_t *image);
+
+/**
+ * Find the function containing an address of an image.
+ *
+ * @param symbolizer Pointer to a valid symbolizer
+ * @param image Index of the image
+ * @param addr Address to look up
+ * @param name Pointer to store the name of the function, may be NULL
+ * @param offset Pointer to store the offset of addr in the function, may be NULL
+ *
+ * \return 0 if a function contains addr, otherwise < 0
+ */
+int elf_symbolize(const elf_symbolizer_t *symbolizer, size_t image, uintptr_t addr, const char **name,
+                  size_t *offset);
+
+
+/* Relocation functions */
+
+/**
+ * Resolve a symbol that is not defined by the ELF file being relocated.
+ *
+ * @param cookie Cookie passed to elf_relocate
+ * @param name Name of the symbol
+ * @param value Pointer to store the address of the symbol
+ *
+ * \return 0 on success, otherwise < 0
+ */
+typedef int (*elf_resolve_fn_t)(void *cookie, const char *name, uintptr_t *value);
+
+/**
+ * Apply the dynamic relocations of a loaded ELF file, so that it can run at
+ * an address other than the one it was linked at.
+ *
+ * @param elf Pointer to a valid ELF structure
+ * @param image Memory holding the loaded segments, where the first byte
+ *              corresponds to the lowest virtual address of elf_getMemoryBounds
+ * @param load_addr Address the lowest virtual address will have at run time.
+ *                  It may only differ from the lowest virtual address for
+ *                  position independent (ET_DYN) ELF files.
+ * @param resolve Function to resolve undefined symbols, may be NULL
+ * @param cookie Cookie passed to resolve
+ *
+ * \return 0 on success, otherwise < 0
+ *
+ * The RELR, REL, RELA and PLT relocation tables of the dynamic section are
+ * applied for x86_64, aarch64, arm and riscv: relative relocations, absolute
+ * 32 and 64 bit relocations and GOT/PLT entries, all bound immediately.
+ * Defined symbols are moved with the image, except absolute (SHN_ABS) ones.
+ * Undefined weak symbols that resolve does not know are zero. Any other
+ * relocation type, e.g. IRELATIVE or TLS relocations, or a 64 bit relocation
+ * in a 32 bit file makes the function fail.
+ */
+int elf_relocate(const elf_t *elf, void *image, uintptr_t load_addr, elf_resolve_fn_t resolve, void *cookie);
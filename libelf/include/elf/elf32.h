@@ -26,6 +26,60 @@ static inline Elf32_Ehdr elf32_getHeader(const elf_t *elf)
     return *(Elf32_Ehdr *) elf->elfFile;
 }
 
+/*
+ * View of the header tables of a 32-bit ELF file. The tables are located once,
+ * so loops over them do not re-read the ELF header for every field.
+ */
+typedef struct elf32_view {
+    const Elf32_Ehdr *header;
+    const Elf32_Phdr *phdrs;
+    size_t num_phdrs;
+    const Elf32_Shdr *shdrs;
+    size_t num_shdrs;
+} elf32_view_t;
+
+static inline elf32_view_t elf32_getView(const elf_t *elf)
+{
+    const Elf32_Ehdr *header = elf->elfFile;
+    elf32_view_t view = {
+        .header = header,
+        .phdrs = elf->elfFile + header->e_phoff,
+        .num_phdrs = header->e_phnum,
+        .shdrs = elf->elfFile + header->e_shoff,
+        .num_shdrs = header->e_shnum,
+    };
+    return view;
+}
+
+static inline elf_phdr_t elf32_decodeProgramHeader(const Elf32_Phdr *ph)
+{
+    elf_phdr_t res = {
+        .type = ph->p_type,
+        .flags = ph->p_flags,
+        .offset = ph->p_offset,
+        .vaddr = ph->p_vaddr,
+        .paddr = ph->p_paddr,
+        .file_size = ph->p_filesz,
+        .mem_size = ph->p_memsz,
+        .align = ph->p_align,
+    };
+    return res;
+}
+
+size_t elf32_getProgramHeaders(const elf_t *elf, size_t first, elf_phdr_t *phdrs, size_t count);
+
+int elf32_getMemoryBounds(const elf_t *elf, elf_addr_type_t addr_type, uintptr_t *min, uintptr_t *max);
+
+static inline uint16_t elf32_getType(const elf_t *file)
+{
+    return elf32_getHeader(file).e_type;
+}
+
+static inline uint16_t elf32_getMachine(const elf_t *file)
+{
+    return elf32_getHeader(file).e_machine;
+}
+
 static inline uintptr_t elf32_getEntryPoint(const elf_t *elf)
 {
     return elf32_getHeader(elf).e_entry;
@@ -26,6 +26,60 @@ static inline Elf64_Ehdr elf64_getHeader(const elf_t *elf)
     return *(Elf64_Ehdr *) elf->elfFile;
 }
 
+/*
+ * View of the header tables of a 64-bit ELF file. The tables are located once,
+ * so loops over them do not re-read the ELF header for every field.
+ */
+typedef struct elf64_view {
+    const Elf64_Ehdr *header;
+    const Elf64_Phdr *phdrs;
+    size_t num_phdrs;
+    const Elf64_Shdr *shdrs;
+    size_t num_shdrs;
+} elf64_view_t;
+
+static inline elf64_view_t elf64_getView(const elf_t *elf)
+{
+    const Elf64_Ehdr *header = elf->elfFile;
+    elf64_view_t view = {
+        .header = header,
+        .phdrs = elf->elfFile + header->e_phoff,
+        .num_phdrs = header->e_phnum,
+        .shdrs = elf->elfFile + header->e_shoff,
+        .num_shdrs = header->e_shnum,
+    };
+    return view;
+}
+
+static inline elf_phdr_t elf64_decodeProgramHeader(const Elf64_Phdr *ph)
+{
+    elf_phdr_t res = {
+        .type = ph->p_type,
+        .flags = ph->p_flags,
+        .offset = ph->p_offset,
+        .vaddr = ph->p_vaddr,
+        .paddr = ph->p_paddr,
+        .file_size = ph->p_filesz,
+        .mem_size = ph->p_memsz,
+        .align = ph->p_align,
+    };
+    return res;
+}
+
+size_t elf64_getProgramHeaders(const elf_t *elf, size_t first, elf_phdr_t *phdrs, size_t count);
+
+int elf64_getMemoryBounds(const elf_t *elf, elf_addr_type_t addr_type, uintptr_t *min, uintptr_t *max);
+
+static inline uint16_t elf64_getType(const elf_t *file)
+{
+    return elf64_getHeader(file).e_type;
+}
+
+static inline uint16_t elf64_getMachine(const elf_t *file)
+{
+    return elf64_getHeader(file).e_machine;
+}
+
 static inline uintptr_t elf64_getEntryPoint(const elf_t *file)
 {
     return elf64_getHeader(file).e_entry;
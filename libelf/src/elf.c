@@ -10,6 +10,9 @@
 #include <string.h>
 #include <stdio.h>
 
+#define ROUND_DOWN_PAGE(x, page_size) ((x) & ~((uintptr_t)(page_size) - 1))
+#define ROUND_UP_PAGE(x, page_size) ROUND_DOWN_PAGE((x) + (page_size) - 1, page_size)
+
 /* ELF header functions */
 int elf_newFile(const void *file, size_t size, elf_t *res)
 {
@@ -104,6 +107,24 @@ uintptr_t elf_getEntryPoint(const elf_t *elfFile)
     }
 }
 
+uint16_t elf_getType(const elf_t *elfFile)
+{
+    if (elf_isElf32(elfFile)) {
+        return elf32_getType(elfFile);
+    } else {
+        return elf64_getType(elfFile);
+    }
+}
+
+uint16_t elf_getMachine(const elf_t *elfFile)
+{
+    if (elf_isElf32(elfFile)) {
+        return elf32_getMachine(elfFile);
+    } else {
+        return elf64_getMachine(elfFile);
+    }
+}
+
 size_t elf_getNumProgramHeaders(const elf_t *elfFile)
 {
     if (elf_isElf32(elfFile)) {
@@ -179,8 +200,101 @@ const void *elf_getSection(const elf_t *elf, size_t i)
     return elf->elfFile + section_offset;
 }
 
+/*
+ * Open addressing hash table from section name to section number. Slots hold
+ * the section number plus one, so that 0 marks an empty slot.
+ */
+struct elf_section_index {
+    bool built;
+    size_t mask;
+    uint32_t slots[];
+};
+
+static uint32_t elf_hashSectionName(const char *name)
+{
+    uint32_t h = 5381;
+    for (const unsigned char *c = (const unsigned char *) name; *c != '\0'; c++) {
+        h = h * 33 + *c;
+    }
+    return h;
+}
+
+static size_t elf_sectionIndexSlots(const elf_t *elf)
+{
+    /* Keep the table at most half full */
+    size_t slots = 1;
+    while (slots < 2 * elf_getNumSections(elf)) {
+        slots *= 2;
+    }
+    return slots;
+}
+
+size_t elf_getSectionIndexSize(const elf_t *elfFile)
+{
+    return sizeof(struct elf_section_index) + elf_sectionIndexSlots(elfFile) * sizeof(uint32_t);
+}
+
+/* Find the slot holding name, or the empty slot where it belongs */
+static uint32_t *elf_findSectionSlot(const elf_t *elf, const char *name)
+{
+    struct elf_section_index *index = elf->sectionIndex;
+    size_t slot = elf_hashSectionName(name) & index->mask;
+    while (index->slots[slot] != 0 && strcmp(name, elf_getSectionName(elf, index->slots[slot] - 1)) != 0) {
+        slot = (slot + 1) & index->mask;
+    }
+    return &index->slots[slot];
+}
+
+static void elf_buildSectionIndex(const elf_t *elf)
+{
+    struct elf_section_index *index = elf->sectionIndex;
+    memset(index->slots, 0, (index->mask + 1) * sizeof(uint32_t));
+
+    size_t numSections = elf_getNumSections(elf);
+    for (size_t i = 0; i < numSections; i++) {
+        uint32_t *slot = elf_findSectionSlot(elf, elf_getSectionName(elf, i));
+        if (*slot == 0) {
+            *slot = i + 1; /* the first section of a name wins */
+        }
+    }
+    index->built = true;
+}
+
+int elf_newSectionIndex(elf_t *elfFile, void *buf, size_t size, bool eager)
+{
+    if (buf == NULL || size < elf_getSectionIndexSize(elfFile) ||
+        ((uintptr_t) buf & (sizeof(void *) - 1)) != 0) {
+        return -1;
+    }
+
+    struct elf_section_index *index = buf;
+    index->built = false;
+    index->mask = elf_sectionIndexSlots(elfFile) - 1;
+    elfFile->sectionIndex = index;
+
+    if (eager) {
+        elf_buildSectionIndex(elfFile);
+    }
+    return 0;
+}
+
 const void *elf_getSectionNamed(const elf_t *elfFile, const char *str, size_t *id)
 {
+    if (elfFile->sectionIndex != NULL) {
+        if (!elfFile->sectionIndex->built) {
+            elf_buildSectionIndex(elfFile);
+        }
+
+        uint32_t slot = *elf_findSectionSlot(elfFile, str);
+        if (slot == 0) {
+            return NULL;
+        }
+        if (id != NULL) {
+            *id = slot - 1;
+        }
+        return elf_getSection(elfFile, slot - 1);
+    }
+
     size_t numSections = elf_getNumSections(elfFile);
     for (size_t i = 0; i < numSections; i++) {
         if (strcmp(str, elf_getSectionName(elfFile, i)) == 0) {
@@ -299,6 +413,69 @@ size_t elf_getSectionEntrySize(const elf_t *elfFile, size_t i)
 
 
 /* Program headers function */
+size_t elf_getProgramHeaders(const elf_t *elf, size_t first, elf_phdr_t *phdrs, size_t count)
+{
+    if (elf_isElf32(elf)) {
+        return elf32_getProgramHeaders(elf, first, phdrs, count);
+    } else {
+        return elf64_getProgramHeaders(elf, first, phdrs, count);
+    }
+}
+
+const void *elf_getVaddrData(const elf_t *elf, uintptr_t vaddr, size_t *size)
+{
+    elf_phdr_t ph;
+    for (size_t i = 0; elf_getProgramHeaders(elf, i, &ph, 1) == 1; i++) {
+        if (ph.type != PT_LOAD || vaddr < ph.vaddr || vaddr - ph.vaddr >= ph.file_size) {
+            continue;
+        }
+
+        const char *segment = elf_getProgramSegment(elf, i);
+        if (segment == NULL) {
+            return NULL;
+        }
+        *size = ph.file_size - (vaddr - ph.vaddr);
+        return segment + (vaddr - ph.vaddr);
+    }
+
+    return NULL;
+}
+
+size_t elf_getDynamicEntries(const elf_t *elf, size_t first, elf_dyn_t *dyn, size_t count)
+{
+    elf_phdr_t ph;
+    size_t i;
+    for (i = 0; elf_getProgramHeaders(elf, i, &ph, 1) == 1; i++) {
+        if (ph.type == PT_DYNAMIC) {
+            break;
+        }
+    }
+    const void *dynamic = elf_getProgramSegment(elf, i);
+    if (ph.type != PT_DYNAMIC || dynamic == NULL) {
+        return 0; /* no dynamic section */
+    }
+
+    size_t entry_size = elf_isElf32(elf) ? sizeof(Elf32_Dyn) : sizeof(Elf64_Dyn);
+    size_t num_entries = ph.file_size / entry_size;
+    size_t decoded;
+    for (decoded = 0; decoded < count && first + decoded < num_entries; decoded++) {
+        const void *entry = dynamic + (first + decoded) * entry_size;
+        if (elf_isElf32(elf)) {
+            const Elf32_Dyn *d = entry;
+            dyn[decoded].tag = d->d_tag;
+            dyn[decoded].value = d->d_un.d_val;
+        } else {
+            const Elf64_Dyn *d = entry;
+            dyn[decoded].tag = d->d_tag;
+            dyn[decoded].value = d->d_un.d_val;
+        }
+        if (dyn[decoded].tag == DT_NULL) {
+            break;
+        }
+    }
+    return decoded;
+}
+
 const void *elf_getProgramSegment(const elf_t *elf, size_t ph)
 {
     size_t offset = elf_getProgramHeaderOffset(elf, ph);
@@ -388,36 +565,178 @@ size_t elf_getProgramHeaderAlign(const elf_t *elfFile, size_t ph)
 /* Utility functions */
 int elf_getMemoryBounds(const elf_t *elfFile, elf_addr_type_t addr_type, uintptr_t *min, uintptr_t *max)
 {
-    uintptr_t mem_min = UINTPTR_MAX;
-    uintptr_t mem_max = 0;
-    size_t i;
+    if (elf_isElf32(elfFile)) {
+        return elf32_getMemoryBounds(elfFile, addr_type, min, max);
+    } else {
+        return elf64_getMemoryBounds(elfFile, addr_type, min, max);
+    }
+}
 
-    for (i = 0; i < elf_getNumProgramHeaders(elfFile); i++) {
-        uintptr_t sect_min, sect_max;
+/* Page layout of an ELF file being computed by elf_getPageLayout */
+struct elf_page_layout {
+    const size_t *page_sizes;
+    size_t num_page_sizes;
+    /* Bounds of the neighbouring segments, which promotion must not overlap */
+    uintptr_t lower;
+    uintptr_t upper;
+    uint32_t flags;
+    /* The largest page size level that the alignment of the segment allows */
+    size_t max_level;
+    elf_page_range_t *ranges;
+    size_t max_ranges;
+    size_t count;
+};
+
+static void elf_addPageRange(struct elf_page_layout *layout, uintptr_t start, uintptr_t end, size_t level)
+{
+    elf_page_range_t range = {
+        .start = start,
+        .size = end - start,
+        .page_size = layout->page_sizes[level],
+        .flags = layout->flags,
+    };
 
-        if (elf_getProgramHeaderMemorySize(elfFile, i) == 0) {
-            continue;
+    /* How much padding would let the range use the next larger page size */
+    if (level + 1 < layout->num_page_sizes) {
+        size_t next = layout->page_sizes[level + 1];
+        uintptr_t window_start = ROUND_DOWN_PAGE(start, next);
+        uintptr_t window_end = ROUND_UP_PAGE(end, next);
+        if (window_end > window_start) {
+            range.promote_size = next;
+            range.promote_padding = (window_end - window_start) - range.size;
+            range.promote_relink = window_start < layout->lower || window_end > layout->upper ||
+                                   level + 1 > layout->max_level;
         }
+    }
 
-        if (addr_type == PHYSICAL) {
-            sect_min = elf_getProgramHeaderPaddr(elfFile, i);
-        } else {
-            sect_min = elf_getProgramHeaderVaddr(elfFile, i);
+    if (layout->count < layout->max_ranges) {
+        layout->ranges[layout->count] = range;
+    }
+    layout->count++;
+}
+
+/* Split [start, end) into the largest pages up to page_sizes[level] that fit */
+static void elf_splitPageRange(struct elf_page_layout *layout, uintptr_t start, uintptr_t end, size_t level)
+{
+    if (start >= end) {
+        return;
+    }
+
+    for (size_t i = level; i > 0; i--) {
+        size_t page_size = layout->page_sizes[i];
+        uintptr_t large_start = ROUND_UP_PAGE(start, page_size);
+        uintptr_t large_end = ROUND_DOWN_PAGE(end, page_size);
+        if (large_start >= start && large_start < large_end) {
+            elf_splitPageRange(layout, start, large_start, i - 1);
+            elf_addPageRange(layout, large_start, large_end, i);
+            elf_splitPageRange(layout, large_end, end, i - 1);
+            return;
         }
+    }
 
-        sect_max = sect_min + elf_getProgramHeaderMemorySize(elfFile, i);
+    elf_addPageRange(layout, start, end, 0);
+}
 
-        if (sect_max > mem_max) {
-            mem_max = sect_max;
+/* The largest page size level that the alignment of a segment allows */
+static size_t elf_segmentPageLevel(const elf_t *elf, const elf_phdr_t *ph, uintptr_t dest,
+                                   const size_t *page_sizes, size_t num_page_sizes)
+{
+    size_t level = 0;
+    for (size_t i = 1; i < num_page_sizes; i++) {
+        size_t page_size = page_sizes[i];
+        /* Pages mapped from the file need the offset congruent to the address */
+        if (ph->file_size > 0 && ((ph->offset - dest) & (page_size - 1)) != 0) {
+            break;
         }
-        if (sect_min < mem_min) {
-            mem_min = sect_min;
+        /* A relocatable image is only placed at a multiple of the alignment */
+        if (elf_getType(elf) == ET_DYN && ph->align < page_size) {
+            break;
         }
+        level = i;
     }
-    *min = mem_min;
-    *max = mem_max;
+    return level;
+}
 
-    return 1;
+size_t elf_getPageLayout(const elf_t *elf, elf_addr_type_t addr_type, const size_t *page_sizes,
+                         size_t num_page_sizes, elf_page_range_t *ranges, size_t max_ranges)
+{
+    if (num_page_sizes == 0) {
+        return 0;
+    }
+    for (size_t i = 0; i < num_page_sizes; i++) {
+        size_t page_size = page_sizes[i];
+        if (page_size == 0 || (page_size & (page_size - 1)) != 0 || (i > 0 && page_size <= page_sizes[i - 1])) {
+            return 0; /* page sizes must be increasing powers of two */
+        }
+    }
+
+    struct elf_page_layout layout = {
+        .page_sizes = page_sizes,
+        .num_page_sizes = num_page_sizes,
+        .ranges = ranges,
+        .max_ranges = max_ranges,
+    };
+    size_t small = page_sizes[0];
+    uintptr_t prev_end = 0;
+    elf_phdr_t ph;
+    size_t i = 0;
+
+    /* Each segment is split once the start of the next one is known */
+    bool pending = false;
+    uintptr_t start = 0, end = 0;
+    uint32_t flags = 0;
+    size_t max_level = 0;
+    for (;;) {
+        bool more = elf_getProgramHeaders(elf, i++, &ph, 1) == 1;
+        if (more && (ph.type != PT_LOAD || ph.mem_size == 0)) {
+            continue;
+        }
+
+        uintptr_t next_start = UINTPTR_MAX;
+        uintptr_t next_end = 0;
+        size_t next_level = 0;
+        if (more) {
+            uintptr_t dest = addr_type == PHYSICAL ? ph.paddr : ph.vaddr;
+            if (dest + ph.mem_size < dest || ROUND_UP_PAGE(dest + ph.mem_size, small) < dest) {
+                return 0; /* malformed segment */
+            }
+            next_start = ROUND_DOWN_PAGE(dest, small);
+            next_end = ROUND_UP_PAGE(dest + ph.mem_size, small);
+            next_level = elf_segmentPageLevel(elf, &ph, dest, page_sizes, num_page_sizes);
+        }
+
+        if (pending) {
+            /*
+             * Neighbouring segments may share a page, which then needs the
+             * permissions of both. Large pages must stay clear of it.
+             */
+            layout.lower = prev_end;
+            layout.upper = next_start;
+            layout.flags = flags;
+            layout.max_level = max_level;
+            uintptr_t large_start = start > prev_end ? start : prev_end;
+            uintptr_t large_end = end < next_start ? end : next_start;
+            if (large_start < large_end) {
+                elf_splitPageRange(&layout, start, large_start, 0);
+                elf_splitPageRange(&layout, large_start, large_end, max_level);
+                elf_splitPageRange(&layout, large_end, end, 0);
+            } else {
+                elf_addPageRange(&layout, start, end, 0);
+            }
+            prev_end = end;
+        }
+
+        if (!more) {
+            break;
+        }
+        pending = true;
+        start = next_start;
+        end = next_end;
+        flags = ph.flags;
+        max_level = next_level;
+    }
+
+    return layout.count;
 }
 
 int elf_vaddrInProgramHeader(const elf_t *elfFile, size_t ph, uintptr_t vaddr)
@@ -464,3 +783,522 @@ int elf_loadFile(const elf_t *elf, elf_addr_type_t addr_type)
 
     return 1;
 }
+
+/* Number of program headers read at once by elf_loadStream */
+#define ELF_STREAM_PHDRS 16
+
+struct elf_stream {
+    elf_read_fn_t read;
+    void *cookie;
+    bool is32;
+    size_t phoff;
+    size_t num_phdrs;
+};
+
+static int elf_streamProgramHeaders(const struct elf_stream *stream, size_t first, elf_phdr_t *phdrs,
+                                    size_t count)
+{
+    union {
+        Elf32_Phdr ph32[ELF_STREAM_PHDRS];
+        Elf64_Phdr ph64[ELF_STREAM_PHDRS];
+    } raw;
+    size_t entry_size = stream->is32 ? sizeof(Elf32_Phdr) : sizeof(Elf64_Phdr);
+
+    if (stream->read(stream->cookie, stream->phoff + first * entry_size, &raw, count * entry_size) != 0) {
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (stream->is32) {
+            phdrs[i] = elf32_decodeProgramHeader(&raw.ph32[i]);
+        } else {
+            phdrs[i] = elf64_decodeProgramHeader(&raw.ph64[i]);
+        }
+    }
+    return 0;
+}
+
+int elf_loadStream(elf_read_fn_t read, void *cookie, size_t size, elf_addr_type_t addr_type, uintptr_t *entry)
+{
+    union {
+        Elf32_Ehdr e32;
+        Elf64_Ehdr e64;
+    } header;
+    memset(&header, 0, sizeof(header));
+    size_t header_size = size < sizeof(header) ? size : sizeof(header);
+    elf_t elf = {
+        .elfFile = &header,
+        .elfSize = size,
+    };
+
+    /* The header checks only look at the ELF header and compare against the file size */
+    if (read(cookie, 0, &header, header_size) != 0 || elf_checkFile(&elf) < 0 ||
+        elf_checkProgramHeaderTable(&elf) < 0) {
+        return -1;
+    }
+
+    struct elf_stream stream = {
+        .read = read,
+        .cookie = cookie,
+        .is32 = elf_isElf32(&elf),
+        .phoff = elf_isElf32(&elf) ? header.e32.e_phoff : header.e64.e_phoff,
+        .num_phdrs = elf_getNumProgramHeaders(&elf),
+    };
+    elf_phdr_t phdrs[ELF_STREAM_PHDRS];
+
+    /* Validate all segments before writing to memory */
+    for (size_t first = 0; first < stream.num_phdrs; first += ELF_STREAM_PHDRS) {
+        size_t count = stream.num_phdrs - first < ELF_STREAM_PHDRS ? stream.num_phdrs - first : ELF_STREAM_PHDRS;
+        if (elf_streamProgramHeaders(&stream, first, phdrs, count) != 0) {
+            return -1;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            elf_phdr_t *ph = &phdrs[i];
+            uintptr_t dest = addr_type == PHYSICAL ? ph->paddr : ph->vaddr;
+            size_t file_end = ph->offset + ph->file_size;
+            if (ph->type == PT_LOAD && (file_end < ph->offset || file_end > size ||
+                                        ph->file_size > ph->mem_size || dest + ph->mem_size < dest)) {
+                return -1; /* segment outside of the file or malformed */
+            }
+        }
+    }
+
+    for (size_t first = 0; first < stream.num_phdrs; first += ELF_STREAM_PHDRS) {
+        size_t count = stream.num_phdrs - first < ELF_STREAM_PHDRS ? stream.num_phdrs - first : ELF_STREAM_PHDRS;
+        /* Small tables are still in phdrs from validating them */
+        if (stream.num_phdrs > ELF_STREAM_PHDRS && elf_streamProgramHeaders(&stream, first, phdrs, count) != 0) {
+            return -1;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            elf_phdr_t *ph = &phdrs[i];
+            if (ph->type != PT_LOAD) {
+                continue;
+            }
+
+            uintptr_t dest = addr_type == PHYSICAL ? ph->paddr : ph->vaddr;
+            if (ph->file_size > 0 && read(cookie, ph->offset, (void *) dest, ph->file_size) != 0) {
+                return -1;
+            }
+            memset((void *)(dest + ph->file_size), 0, ph->mem_size - ph->file_size);
+        }
+    }
+
+    if (entry != NULL) {
+        *entry = elf_getEntryPoint(&elf);
+    }
+    return 0;
+}
+
+static int elf_loaderCopy(const elf_loader_t *loader, uintptr_t dest, const void *src, size_t len,
+                          uint32_t flags)
+{
+    if (len == 0) {
+        return 0;
+    }
+    if (loader->copy == NULL) {
+        memcpy((void *) dest, src, len);
+        return 0;
+    }
+    return loader->copy(loader->cookie, dest, src, len, flags);
+}
+
+/*
+ * Copy data such that no single copy crosses a page boundary at the destination,
+ * hashing each page while it is still in the cache if hash is not NULL.
+ */
+static int elf_loaderCopyPages(const elf_loader_t *loader, uintptr_t dest, const char *src, size_t len,
+                               size_t page_size, uint32_t flags, elf_sha256_t *hash)
+{
+    uintptr_t end = dest + len;
+    for (uintptr_t pos = dest; pos < end;) {
+        uintptr_t next = ROUND_DOWN_PAGE(pos, page_size) + page_size;
+        if (next > end || next < pos) {
+            next = end;
+        }
+        int error = elf_loaderCopy(loader, pos, src + (pos - dest), next - pos, flags);
+        if (error) {
+            return error;
+        }
+        if (hash != NULL) {
+            elf_sha256Update(hash, src + (pos - dest), next - pos);
+        }
+        pos = next;
+    }
+    return 0;
+}
+
+static int elf_loaderZero(const elf_loader_t *loader, uintptr_t dest, size_t len, uint32_t flags)
+{
+    if (len == 0) {
+        return 0;
+    }
+    if (loader->zero == NULL) {
+        memset((void *) dest, 0, len);
+        return 0;
+    }
+    return loader->zero(loader->cookie, dest, len, flags);
+}
+
+/* Place file data at dest, mapping whole pages if the loader can and source and destination allow it. */
+static int elf_loaderPlaceData(const elf_loader_t *loader, uintptr_t dest, const char *src, size_t len,
+                               size_t page_size, uint32_t flags, elf_sha256_t *hash)
+{
+    uintptr_t file_end = dest + len;
+    if (loader->map == NULL || ((dest ^ (uintptr_t) src) & (page_size - 1)) != 0 ||
+        ROUND_UP_PAGE(dest, page_size) >= ROUND_DOWN_PAGE(file_end, page_size)) {
+        return elf_loaderCopyPages(loader, dest, src, len, page_size, flags, hash);
+    }
+
+    /* Source and destination share the page offset, whole pages can be mapped. */
+    uintptr_t map_start = ROUND_UP_PAGE(dest, page_size);
+    uintptr_t map_end = ROUND_DOWN_PAGE(file_end, page_size);
+    int error = elf_loaderCopyPages(loader, dest, src, map_start - dest, page_size, flags, hash);
+    if (!error) {
+        error = loader->map(loader->cookie, map_start, src + (map_start - dest), map_end - map_start, flags);
+    }
+    if (!error && hash != NULL) {
+        elf_sha256Update(hash, src + (map_start - dest), map_end - map_start);
+    }
+    if (!error) {
+        error = elf_loaderCopyPages(loader, map_end, src + (map_end - dest), file_end - map_end, page_size,
+                                    flags, hash);
+    }
+    return error;
+}
+
+/* Zero the rest of a partial page, then whole pages, then the final partial page. */
+static int elf_loaderZeroRange(const elf_loader_t *loader, uintptr_t dest, size_t len, size_t page_size,
+                               uint32_t flags)
+{
+    uintptr_t end = dest + len;
+    uintptr_t zero_start = ROUND_UP_PAGE(dest, page_size);
+    if (zero_start > end) {
+        zero_start = end;
+    }
+    uintptr_t zero_end = ROUND_DOWN_PAGE(end, page_size);
+    if (zero_end < zero_start) {
+        zero_end = zero_start;
+    }
+    int error = elf_loaderZero(loader, dest, zero_start - dest, flags);
+    if (!error) {
+        error = elf_loaderZero(loader, zero_start, zero_end - zero_start, flags);
+    }
+    if (!error) {
+        error = elf_loaderZero(loader, zero_end, end - zero_end, flags);
+    }
+    return error;
+}
+
+static void elf_putLittleEndian(uint8_t *buf, uint64_t value, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        buf[i] = value >> (8 * i);
+    }
+}
+
+/*
+ * Load the PT_LOAD segments, hashing them if image_hash is not NULL. The
+ * digest of segment i is stored in segment_digests[i] if there is room.
+ */
+static int elf_loadSegmentsHashing(const elf_t *elf, elf_addr_type_t addr_type, size_t page_size,
+                                   const elf_loader_t *loader, uint8_t (*segment_digests)[ELF_SHA256_DIGEST_SIZE],
+                                   size_t max_segments, elf_sha256_t *image_hash)
+{
+    if (loader == NULL || page_size == 0 || (page_size & (page_size - 1)) != 0) {
+        return -1;
+    }
+
+    elf_phdr_t ph;
+    size_t segment = 0;
+    for (size_t i = 0; elf_getProgramHeaders(elf, i, &ph, 1) == 1; i++) {
+        if (ph.type != PT_LOAD) {
+            continue;
+        }
+
+        uintptr_t dest = addr_type == PHYSICAL ? ph.paddr : ph.vaddr;
+        const char *src = elf_getProgramSegment(elf, i);
+        if (src == NULL || ph.file_size > ph.mem_size || dest + ph.mem_size < dest) {
+            return -1; /* segment outside of the file or malformed */
+        }
+
+        elf_sha256_t segment_hash;
+        if (image_hash != NULL) {
+            elf_sha256Init(&segment_hash);
+        }
+        int error = elf_loaderPlaceData(loader, dest, src, ph.file_size, page_size, ph.flags,
+                                        image_hash != NULL ? &segment_hash : NULL);
+        if (!error) {
+            error = elf_loaderZeroRange(loader, dest + ph.file_size, ph.mem_size - ph.file_size, page_size,
+                                        ph.flags);
+        }
+        if (error) {
+            return error;
+        }
+
+        if (image_hash != NULL) {
+            uint8_t record[8 + 8 + 4 + ELF_SHA256_DIGEST_SIZE];
+            elf_putLittleEndian(record, dest, 8);
+            elf_putLittleEndian(record + 8, ph.mem_size, 8);
+            elf_putLittleEndian(record + 16, ph.flags, 4);
+            elf_sha256Final(&segment_hash, record + 20);
+            elf_sha256Update(image_hash, record, sizeof(record));
+            if (segment_digests != NULL && segment < max_segments) {
+                memcpy(segment_digests[segment], record + 20, ELF_SHA256_DIGEST_SIZE);
+            }
+        }
+        segment++;
+    }
+
+    return 0;
+}
+
+int elf_loadSegments(const elf_t *elf, elf_addr_type_t addr_type, size_t page_size,
+                     const elf_loader_t *loader)
+{
+    return elf_loadSegmentsHashing(elf, addr_type, page_size, loader, NULL, 0, NULL);
+}
+
+int elf_loadSegmentsHashed(const elf_t *elf, elf_addr_type_t addr_type, size_t page_size,
+                           const elf_loader_t *loader, uint8_t (*segment_digests)[ELF_SHA256_DIGEST_SIZE],
+                           size_t max_segments, uint8_t image_digest[ELF_SHA256_DIGEST_SIZE])
+{
+    if (segment_digests != NULL) {
+        size_t num_segments = 0;
+        elf_phdr_t ph;
+        for (size_t i = 0; elf_getProgramHeaders(elf, i, &ph, 1) == 1; i++) {
+            num_segments += ph.type == PT_LOAD;
+        }
+        if (num_segments > max_segments) {
+            return -1;
+        }
+    }
+
+    elf_sha256_t image_hash;
+    elf_sha256Init(&image_hash);
+    int error = elf_loadSegmentsHashing(elf, addr_type, page_size, loader, segment_digests, max_segments,
+                                        &image_hash);
+    if (!error && image_digest != NULL) {
+        elf_sha256Final(&image_hash, image_digest);
+    }
+    return error;
+}
+
+/* Load plan functions */
+
+size_t elf_getLoadPlanSize(const elf_t *elf)
+{
+    /* At most a page range, a copy and a zero range per PT_LOAD segment, plus one page range per shared page */
+    size_t num_ops = 0;
+    elf_phdr_t ph;
+    for (size_t i = 0; elf_getProgramHeaders(elf, i, &ph, 1) == 1; i++) {
+        if (ph.type == PT_LOAD) {
+            num_ops += 4;
+        }
+    }
+    return sizeof(elf_load_plan_t) + num_ops * sizeof(elf_load_op_t);
+}
+
+static elf_load_op_t *elf_planPush(elf_load_plan_t *plan, size_t max_ops, uint32_t type, uint64_t dest,
+                                   uint64_t src, uint64_t len, uint32_t flags)
+{
+    if (plan->num_ops == max_ops) {
+        return NULL;
+    }
+    elf_load_op_t *op = &plan->ops[plan->num_ops++];
+    *op = (elf_load_op_t) {
+        .dest = dest,
+        .src = src,
+        .len = len,
+        .type = type,
+        .flags = flags,
+    };
+    return op;
+}
+
+/*
+ * Add the pages [dest, end) with the given permissions. Segments are sorted by
+ * address, so a new range can only share its first page with the last range;
+ * that page gets the permissions of both segments.
+ */
+static int elf_planAddPages(elf_load_plan_t *plan, size_t max_ops, uint64_t dest, uint64_t end, uint32_t flags)
+{
+    elf_load_op_t *last = plan->num_ops > 0 ? &plan->ops[plan->num_ops - 1] : NULL;
+    if (last != NULL && dest < last->dest + last->len) {
+        uint64_t last_end = last->dest + last->len;
+        uint64_t shared_end = end < last_end ? end : last_end;
+        if ((last->flags | flags) != last->flags) {
+            last->len = dest - last->dest;
+            if (last->len == 0) {
+                plan->num_ops--;
+            }
+            if (elf_planPush(plan, max_ops, ELF_LOAD_OP_PAGES, dest, 0, shared_end - dest,
+                             last->flags | flags) == NULL) {
+                return -1;
+            }
+            last = &plan->ops[plan->num_ops - 1];
+        }
+        dest = shared_end;
+    }
+    if (dest >= end) {
+        return 0;
+    }
+
+    if (last != NULL && last->dest + last->len == dest && last->flags == flags) {
+        last->len += end - dest;
+        return 0;
+    }
+    return elf_planPush(plan, max_ops, ELF_LOAD_OP_PAGES, dest, 0, end - dest, flags) == NULL ? -1 : 0;
+}
+
+/* Add a copy or zero range, merging it with the previous one where both are contiguous */
+static int elf_planAddData(elf_load_plan_t *plan, size_t max_ops, uint32_t type, uint64_t dest, uint64_t src,
+                           uint64_t len, uint32_t flags)
+{
+    if (len == 0) {
+        return 0;
+    }
+
+    elf_load_op_t *last = plan->num_ops > 0 ? &plan->ops[plan->num_ops - 1] : NULL;
+    if (last != NULL && last->type == type && last->flags == flags && last->dest + last->len == dest &&
+        (type != ELF_LOAD_OP_COPY || last->src + last->len == src)) {
+        last->len += len;
+        return 0;
+    }
+    return elf_planPush(plan, max_ops, type, dest, src, len, flags) == NULL ? -1 : 0;
+}
+
+int elf_newLoadPlan(const elf_t *elf, elf_addr_type_t addr_type, size_t page_size, elf_load_plan_t *plan,
+                    size_t size)
+{
+    if (page_size == 0 || (page_size & (page_size - 1)) != 0 || size < sizeof(elf_load_plan_t)) {
+        return -1;
+    }
+    size_t max_ops = (size - sizeof(elf_load_plan_t)) / sizeof(elf_load_op_t);
+
+    /* Validate the segments and find the bounds of the image */
+    uintptr_t min = UINTPTR_MAX;
+    uintptr_t max = 0;
+    elf_phdr_t ph;
+    for (size_t i = 0; elf_getProgramHeaders(elf, i, &ph, 1) == 1; i++) {
+        if (ph.type != PT_LOAD) {
+            continue;
+        }
+
+        uintptr_t dest = addr_type == PHYSICAL ? ph.paddr : ph.vaddr;
+        if (elf_getProgramSegment(elf, i) == NULL || ph.file_size > ph.mem_size ||
+            dest + ph.mem_size < dest || dest < max) {
+            return -1; /* segment outside of the file, malformed or out of order */
+        }
+        if (ph.mem_size == 0) {
+            continue;
+        }
+        if (dest < min) {
+            min = dest;
+        }
+        max = dest + ph.mem_size;
+    }
+    if (min > max || ROUND_UP_PAGE(max, page_size) < max) {
+        return -1; /* nothing to load */
+    }
+
+    *plan = (elf_load_plan_t) {
+        .magic = ELF_LOAD_PLAN_MAGIC,
+        .version = ELF_LOAD_PLAN_VERSION,
+        .flags = elf_getType(elf) == ET_DYN ? ELF_LOAD_PLAN_RELOCATABLE : 0,
+        .base = ROUND_DOWN_PAGE(min, page_size),
+        .size = ROUND_UP_PAGE(max, page_size) - ROUND_DOWN_PAGE(min, page_size),
+        .entry = elf_getEntryPoint(elf),
+        .page_size = page_size,
+    };
+
+    /* Page ranges first, so that they can be set up before any data is placed */
+    for (size_t i = 0; elf_getProgramHeaders(elf, i, &ph, 1) == 1; i++) {
+        uintptr_t dest = addr_type == PHYSICAL ? ph.paddr : ph.vaddr;
+        if (ph.type == PT_LOAD && ph.mem_size > 0 &&
+            elf_planAddPages(plan, max_ops, ROUND_DOWN_PAGE(dest, page_size) - plan->base,
+                             ROUND_UP_PAGE(dest + ph.mem_size, page_size) - plan->base, ph.flags) != 0) {
+            return -1;
+        }
+    }
+
+    for (size_t i = 0; elf_getProgramHeaders(elf, i, &ph, 1) == 1; i++) {
+        if (ph.type != PT_LOAD) {
+            continue;
+        }
+        uint64_t dest = (addr_type == PHYSICAL ? ph.paddr : ph.vaddr) - plan->base;
+        if (elf_planAddData(plan, max_ops, ELF_LOAD_OP_COPY, dest, ph.offset, ph.file_size, ph.flags) != 0 ||
+            elf_planAddData(plan, max_ops, ELF_LOAD_OP_ZERO, dest + ph.file_size, 0,
+                            ph.mem_size - ph.file_size, ph.flags) != 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+size_t elf_getLoadPlanLength(const elf_load_plan_t *plan)
+{
+    return sizeof(elf_load_plan_t) + plan->num_ops * sizeof(elf_load_op_t);
+}
+
+int elf_checkLoadPlan(const elf_load_plan_t *plan, size_t size, size_t file_size)
+{
+    if (size < sizeof(elf_load_plan_t) || plan->magic != ELF_LOAD_PLAN_MAGIC ||
+        plan->version != ELF_LOAD_PLAN_VERSION) {
+        return -1;
+    }
+    if (plan->page_size == 0 || (plan->page_size & (plan->page_size - 1)) != 0 ||
+        (plan->base & (plan->page_size - 1)) != 0) {
+        return -1;
+    }
+    /* The image must fit in the address space, written such that it cannot overflow */
+    if (plan->base > UINTPTR_MAX || plan->size > UINTPTR_MAX - plan->base) {
+        return -1;
+    }
+    if (plan->num_ops > (size - sizeof(elf_load_plan_t)) / sizeof(elf_load_op_t)) {
+        return -1; /* truncated */
+    }
+
+    for (size_t i = 0; i < plan->num_ops; i++) {
+        const elf_load_op_t *op = &plan->ops[i];
+        if (op->type != ELF_LOAD_OP_PAGES && op->type != ELF_LOAD_OP_COPY && op->type != ELF_LOAD_OP_ZERO) {
+            return -1;
+        }
+        if (op->dest > plan->size || op->len > plan->size - op->dest) {
+            return -1; /* outside of the image */
+        }
+        if (op->type == ELF_LOAD_OP_COPY && (op->src > file_size || op->len > file_size - op->src)) {
+            return -1; /* outside of the file */
+        }
+    }
+
+    return 0;
+}
+
+int elf_applyLoadPlan(const elf_load_plan_t *plan, const void *file, uintptr_t base, const elf_loader_t *loader)
+{
+    if (loader == NULL || (base != plan->base && !(plan->flags & ELF_LOAD_PLAN_RELOCATABLE)) ||
+        (base & (plan->page_size - 1)) != 0) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < plan->num_ops; i++) {
+        const elf_load_op_t *op = &plan->ops[i];
+        int error = 0;
+        switch (op->type) {
+        case ELF_LOAD_OP_COPY:
+            error = elf_loaderPlaceData(loader, base + op->dest, (const char *) file + op->src, op->len,
+                                        plan->page_size, op->flags, NULL);
+            break;
+        case ELF_LOAD_OP_ZERO:
+            error = elf_loaderZeroRange(loader, base + op->dest, op->len, plan->page_size, op->flags);
+            break;
+        }
+        if (error) {
+            return error;
+        }
+    }
+
+    return 0;
+}
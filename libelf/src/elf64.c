@@ -66,3 +66,46 @@ int elf64_checkSectionTable(const elf_t *elf)
 
     return 0;
 }
+
+size_t elf64_getProgramHeaders(const elf_t *elf, size_t first, elf_phdr_t *phdrs, size_t count)
+{
+    elf64_view_t view = elf64_getView(elf);
+    if (first >= view.num_phdrs) {
+        return 0;
+    }
+    if (count > view.num_phdrs - first) {
+        count = view.num_phdrs - first;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        phdrs[i] = elf64_decodeProgramHeader(&view.phdrs[first + i]);
+    }
+    return count;
+}
+
+int elf64_getMemoryBounds(const elf_t *elf, elf_addr_type_t addr_type, uintptr_t *min, uintptr_t *max)
+{
+    elf64_view_t view = elf64_getView(elf);
+    uintptr_t mem_min = UINTPTR_MAX;
+    uintptr_t mem_max = 0;
+
+    for (size_t i = 0; i < view.num_phdrs; i++) {
+        const Elf64_Phdr *ph = &view.phdrs[i];
+        if (ph->p_memsz == 0) {
+            continue;
+        }
+
+        uintptr_t sect_min = addr_type == PHYSICAL ? ph->p_paddr : ph->p_vaddr;
+        uintptr_t sect_max = sect_min + ph->p_memsz;
+        if (sect_max > mem_max) {
+            mem_max = sect_max;
+        }
+        if (sect_min < mem_min) {
+            mem_min = sect_min;
+        }
+    }
+    *min = mem_min;
+    *max = mem_max;
+
+    return 1;
+}
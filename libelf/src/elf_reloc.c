@@ -0,0 +1,488 @@
+/*
+ * Copyright 2026, agent
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <elf/elf.h>
+#include <elf/elf32.h>
+#include <elf/elf64.h>
+#include <string.h>
+
+#ifndef DT_RELRSZ
+#define DT_RELRSZ 35
+#define DT_RELR 36
+#define DT_RELRENT 37
+#endif
+
+/*
+ * What a relocation type computes, with B the load bias, S the symbol value and A the addend.
+ * Absolute relocations have a fixed width, the others relocate a word of the image class.
+ */
+enum elf_reloc_kind {
+    ELF_RELOC_UNSUPPORTED,
+    ELF_RELOC_NONE,
+    ELF_RELOC_RELATIVE,     /* B + A */
+    ELF_RELOC_ABSOLUTE32,   /* S + A, 32 bits wide */
+    ELF_RELOC_ABSOLUTE64,   /* S + A, 64 bits wide */
+    ELF_RELOC_SYMBOL,       /* S */
+};
+
+/* A relocation table of the dynamic section */
+struct elf_reloc_table {
+    uintptr_t addr;
+    size_t size;
+    size_t entry_size;
+};
+
+/* A REL or RELA relocation, independent of the class of the ELF file */
+struct elf_reloc {
+    uintptr_t offset;
+    uint32_t type;
+    uint32_t sym;
+    int64_t addend;
+};
+
+struct elf_relocator {
+    const elf_t *elf;
+    uint16_t machine;
+    size_t word_size;
+    uint32_t relative_type;
+    char *image;
+    uintptr_t min_vaddr;
+    size_t image_size;
+    uintptr_t bias;
+    elf_symtab_t symtab;
+    elf_resolve_fn_t resolve;
+    void *cookie;
+};
+
+static enum elf_reloc_kind elf_relocKind(uint16_t machine, uint32_t type)
+{
+    switch (machine) {
+    case EM_X86_64:
+        switch (type) {
+        case R_X86_64_NONE:
+            return ELF_RELOC_NONE;
+        case R_X86_64_RELATIVE:
+            return ELF_RELOC_RELATIVE;
+        case R_X86_64_64:
+            return ELF_RELOC_ABSOLUTE64;
+        case R_X86_64_GLOB_DAT:
+        case R_X86_64_JUMP_SLOT:
+            return ELF_RELOC_SYMBOL;
+        }
+        break;
+    case EM_AARCH64:
+        switch (type) {
+        case R_AARCH64_NONE:
+            return ELF_RELOC_NONE;
+        case R_AARCH64_RELATIVE:
+            return ELF_RELOC_RELATIVE;
+        case R_AARCH64_ABS64:
+        case R_AARCH64_GLOB_DAT:
+        case R_AARCH64_JUMP_SLOT:
+            return ELF_RELOC_ABSOLUTE64;
+        }
+        break;
+    case EM_ARM:
+        switch (type) {
+        case R_ARM_NONE:
+            return ELF_RELOC_NONE;
+        case R_ARM_RELATIVE:
+            return ELF_RELOC_RELATIVE;
+        case R_ARM_ABS32:
+            return ELF_RELOC_ABSOLUTE32;
+        case R_ARM_GLOB_DAT:
+        case R_ARM_JUMP_SLOT:
+            return ELF_RELOC_SYMBOL;
+        }
+        break;
+    case EM_RISCV:
+        switch (type) {
+        case R_RISCV_NONE:
+            return ELF_RELOC_NONE;
+        case R_RISCV_RELATIVE:
+            return ELF_RELOC_RELATIVE;
+        case R_RISCV_32:
+            return ELF_RELOC_ABSOLUTE32;
+        case R_RISCV_64:
+            return ELF_RELOC_ABSOLUTE64;
+        case R_RISCV_JUMP_SLOT:
+            return ELF_RELOC_SYMBOL;
+        }
+        break;
+    }
+
+    return ELF_RELOC_UNSUPPORTED;
+}
+
+static uint32_t elf_relativeType(uint16_t machine)
+{
+    switch (machine) {
+    case EM_X86_64:
+        return R_X86_64_RELATIVE;
+    case EM_AARCH64:
+        return R_AARCH64_RELATIVE;
+    case EM_ARM:
+        return R_ARM_RELATIVE;
+    case EM_RISCV:
+        return R_RISCV_RELATIVE;
+    }
+    return 0;
+}
+
+/* Number of bytes relocated by a kind of relocation */
+static size_t elf_relocWidth(const struct elf_relocator *r, enum elf_reloc_kind kind)
+{
+    switch (kind) {
+    case ELF_RELOC_ABSOLUTE32:
+        return sizeof(uint32_t);
+    case ELF_RELOC_ABSOLUTE64:
+        return sizeof(uint64_t);
+    default:
+        return r->word_size;
+    }
+}
+
+/* Locate the bytes of the image that a relocation of some width modifies */
+static char *elf_relocTarget(const struct elf_relocator *r, uintptr_t vaddr, size_t width)
+{
+    if (vaddr < r->min_vaddr || r->image_size < width || vaddr - r->min_vaddr > r->image_size - width) {
+        return NULL;
+    }
+    return r->image + (vaddr - r->min_vaddr);
+}
+
+static uint64_t elf_relocRead(const char *target, size_t width)
+{
+    if (width == sizeof(uint32_t)) {
+        uint32_t value;
+        memcpy(&value, target, sizeof(value));
+        return value;
+    } else {
+        uint64_t value;
+        memcpy(&value, target, sizeof(value));
+        return value;
+    }
+}
+
+static void elf_relocWrite(char *target, size_t width, uint64_t value)
+{
+    if (width == sizeof(uint32_t)) {
+        uint32_t word = value;
+        memcpy(target, &word, sizeof(word));
+    } else {
+        memcpy(target, &value, sizeof(value));
+    }
+}
+
+static void elf_readReloc(const struct elf_relocator *r, const void *entry, bool rela, struct elf_reloc *reloc)
+{
+    if (r->word_size == sizeof(uint32_t)) {
+        const Elf32_Rela *rel = entry;
+        reloc->offset = rel->r_offset;
+        reloc->type = ELF32_R_TYPE(rel->r_info);
+        reloc->sym = ELF32_R_SYM(rel->r_info);
+        reloc->addend = rela ? rel->r_addend : 0;
+    } else {
+        const Elf64_Rela *rel = entry;
+        reloc->offset = rel->r_offset;
+        reloc->type = ELF64_R_TYPE(rel->r_info);
+        reloc->sym = ELF64_R_SYM(rel->r_info);
+        reloc->addend = rela ? rel->r_addend : 0;
+    }
+}
+
+/* Compute the value of the symbol of a relocation */
+static int elf_relocSymbol(const struct elf_relocator *r, uint32_t index, uint64_t *value)
+{
+    if (index == STN_UNDEF) {
+        *value = 0;
+        return 0;
+    }
+
+    elf_symbol_t sym;
+    if (elf_getSymbol(&r->symtab, index, &sym) != 0 || sym.name == NULL) {
+        return -1;
+    }
+    if (sym.shndx == SHN_ABS) {
+        /* Absolute symbols do not move with the image */
+        *value = sym.value;
+        return 0;
+    } else if (sym.shndx != SHN_UNDEF) {
+        *value = (uint64_t) sym.value + r->bias;
+        return 0;
+    }
+
+    uintptr_t resolved;
+    if (r->resolve != NULL && r->resolve(r->cookie, sym.name, &resolved) == 0) {
+        *value = resolved;
+        return 0;
+    }
+    if (sym.bind == STB_WEAK) {
+        *value = 0; /* unresolved weak symbols are zero */
+        return 0;
+    }
+
+    return -1;
+}
+
+static int elf_applyReloc(const struct elf_relocator *r, const struct elf_reloc *reloc, bool rela)
+{
+    enum elf_reloc_kind kind = elf_relocKind(r->machine, reloc->type);
+    if (kind == ELF_RELOC_NONE) {
+        return 0;
+    } else if (kind == ELF_RELOC_UNSUPPORTED) {
+        return -1;
+    }
+
+    /* A 64 bit relocation cannot be applied to a 32 bit image */
+    size_t width = elf_relocWidth(r, kind);
+    if (width > r->word_size) {
+        return -1;
+    }
+
+    char *target = elf_relocTarget(r, reloc->offset, width);
+    if (target == NULL) {
+        return -1;
+    }
+    /* REL relocations keep the addend in the relocated field */
+    uint64_t addend = rela ? (uint64_t) reloc->addend : elf_relocRead(target, width);
+
+    uint64_t value;
+    if (kind == ELF_RELOC_RELATIVE) {
+        value = r->bias + addend;
+    } else {
+        if (elf_relocSymbol(r, reloc->sym, &value) != 0) {
+            return -1;
+        }
+        if (kind == ELF_RELOC_ABSOLUTE32 || kind == ELF_RELOC_ABSOLUTE64) {
+            value += addend;
+        }
+    }
+
+    elf_relocWrite(target, width, value);
+    return 0;
+}
+
+/* Apply a REL or RELA table */
+static int elf_applyRelocTable(const struct elf_relocator *r, const struct elf_reloc_table *table, bool rela)
+{
+    if (table->size == 0) {
+        return 0;
+    }
+
+    size_t min_size;
+    if (r->word_size == sizeof(uint32_t)) {
+        min_size = rela ? sizeof(Elf32_Rela) : sizeof(Elf32_Rel);
+    } else {
+        min_size = rela ? sizeof(Elf64_Rela) : sizeof(Elf64_Rel);
+    }
+    size_t entry_size = table->entry_size != 0 ? table->entry_size : min_size;
+    size_t avail;
+    const char *entries = elf_getVaddrData(r->elf, table->addr, &avail);
+    if (entries == NULL || entry_size < min_size || avail < table->size) {
+        return -1;
+    }
+
+    size_t count = table->size / entry_size;
+    size_t i = 0;
+
+    /*
+     * Linkers sort the relative relocations to the front of the table. Apply
+     * them in a loop that does not look at symbols or relocation kinds.
+     */
+    for (; i < count; i++) {
+        struct elf_reloc reloc;
+        elf_readReloc(r, entries + i * entry_size, rela, &reloc);
+        if (reloc.type != r->relative_type) {
+            break;
+        }
+
+        char *target = elf_relocTarget(r, reloc.offset, r->word_size);
+        if (target == NULL) {
+            return -1;
+        }
+        uint64_t addend = rela ? (uint64_t) reloc.addend : elf_relocRead(target, r->word_size);
+        elf_relocWrite(target, r->word_size, r->bias + addend);
+    }
+
+    for (; i < count; i++) {
+        struct elf_reloc reloc;
+        elf_readReloc(r, entries + i * entry_size, rela, &reloc);
+        if (elf_applyReloc(r, &reloc, rela) != 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Apply a RELR table. An even entry is the address of a word to relocate; an
+ * odd entry is a bitmap whose bits 1 and up select which of the following
+ * words to relocate, continuing from the last address.
+ */
+static int elf_applyRelrTable(const struct elf_relocator *r, const struct elf_reloc_table *table)
+{
+    if (table->size == 0) {
+        return 0;
+    }
+
+    size_t avail;
+    const char *entries = elf_getVaddrData(r->elf, table->addr, &avail);
+    if (entries == NULL || (table->entry_size != 0 && table->entry_size != r->word_size) || avail < table->size) {
+        return -1;
+    }
+
+    size_t count = table->size / r->word_size;
+    size_t bits = r->word_size * 8 - 1;
+    uintptr_t where = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint64_t entry = elf_relocRead(entries + i * r->word_size, r->word_size);
+        if ((entry & 1) == 0) {
+            char *target = elf_relocTarget(r, entry, r->word_size);
+            if (target == NULL) {
+                return -1;
+            }
+            elf_relocWrite(target, r->word_size, elf_relocRead(target, r->word_size) + r->bias);
+            where = entry + r->word_size;
+            continue;
+        }
+
+        for (uintptr_t addr = where; (entry >>= 1) != 0; addr += r->word_size) {
+            if ((entry & 1) == 0) {
+                continue;
+            }
+            char *target = elf_relocTarget(r, addr, r->word_size);
+            if (target == NULL) {
+                return -1;
+            }
+            elf_relocWrite(target, r->word_size, elf_relocRead(target, r->word_size) + r->bias);
+        }
+        where += bits * r->word_size;
+    }
+
+    return 0;
+}
+
+int elf_relocate(const elf_t *elf, void *image, uintptr_t load_addr, elf_resolve_fn_t resolve, void *cookie)
+{
+    uintptr_t min_vaddr, max_vaddr;
+    elf_getMemoryBounds(elf, VIRTUAL, &min_vaddr, &max_vaddr);
+    if (max_vaddr < min_vaddr) {
+        return -1; /* nothing to load */
+    }
+
+    struct elf_relocator r = {
+        .elf = elf,
+        .machine = elf_getMachine(elf),
+        .word_size = elf_isElf32(elf) ? sizeof(uint32_t) : sizeof(uint64_t),
+        .image = image,
+        .min_vaddr = min_vaddr,
+        .image_size = max_vaddr - min_vaddr,
+        .bias = load_addr - min_vaddr,
+        .symtab = {
+            .elf = elf,
+        },
+        .resolve = resolve,
+        .cookie = cookie,
+    };
+    r.relative_type = elf_relativeType(r.machine);
+    if (r.relative_type == 0 || r.image_size < r.word_size) {
+        return -1; /* unsupported machine */
+    }
+    if (elf_getType(elf) != ET_DYN && r.bias != 0) {
+        return -1; /* only position independent images can be moved */
+    }
+
+    struct elf_reloc_table rel = {0}, rela = {0}, relr = {0}, plt = {0};
+    int64_t plt_type = DT_NULL;
+    uintptr_t symbols = 0, strings = 0;
+    size_t strings_size = 0;
+    elf_dyn_t dyn[16];
+    size_t count;
+    for (size_t first = 0; (count = elf_getDynamicEntries(elf, first, dyn, 16)) > 0; first += count) {
+        for (size_t i = 0; i < count; i++) {
+            uint64_t value = dyn[i].value;
+            switch (dyn[i].tag) {
+            case DT_REL:
+                rel.addr = value;
+                break;
+            case DT_RELSZ:
+                rel.size = value;
+                break;
+            case DT_RELENT:
+                rel.entry_size = value;
+                break;
+            case DT_RELA:
+                rela.addr = value;
+                break;
+            case DT_RELASZ:
+                rela.size = value;
+                break;
+            case DT_RELAENT:
+                rela.entry_size = value;
+                break;
+            case DT_RELR:
+                relr.addr = value;
+                break;
+            case DT_RELRSZ:
+                relr.size = value;
+                break;
+            case DT_RELRENT:
+                relr.entry_size = value;
+                break;
+            case DT_JMPREL:
+                plt.addr = value;
+                break;
+            case DT_PLTRELSZ:
+                plt.size = value;
+                break;
+            case DT_PLTREL:
+                plt_type = value;
+                break;
+            case DT_SYMTAB:
+                symbols = value;
+                break;
+            case DT_SYMENT:
+                r.symtab.sym_size = value;
+                break;
+            case DT_STRTAB:
+                strings = value;
+                break;
+            case DT_STRSZ:
+                strings_size = value;
+                break;
+            }
+        }
+    }
+
+    /* Symbol indices are only checked against the end of the segment holding the symbol table */
+    size_t symbols_avail, strings_avail;
+    r.symtab.symbols = elf_getVaddrData(elf, symbols, &symbols_avail);
+    r.symtab.strings = elf_getVaddrData(elf, strings, &strings_avail);
+    size_t min_sym_size = elf_isElf32(elf) ? sizeof(Elf32_Sym) : sizeof(Elf64_Sym);
+    if (r.symtab.symbols != NULL && r.symtab.sym_size >= min_sym_size && r.symtab.strings != NULL &&
+        strings_size > 0 && strings_size <= strings_avail && r.symtab.strings[strings_size - 1] == '\0') {
+        r.symtab.num_symbols = symbols_avail / r.symtab.sym_size;
+        r.symtab.strings_size = strings_size;
+    }
+
+    if (plt.size != 0) {
+        if (plt_type != DT_REL && plt_type != DT_RELA) {
+            return -1;
+        }
+        plt.entry_size = plt_type == DT_RELA ? rela.entry_size : rel.entry_size;
+    }
+
+    if (elf_applyRelrTable(&r, &relr) != 0 ||
+        elf_applyRelocTable(&r, &rel, false) != 0 ||
+        elf_applyRelocTable(&r, &rela, true) != 0 ||
+        elf_applyRelocTable(&r, &plt, plt_type == DT_RELA) != 0) {
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,221 @@
+/*
+ * Copyright 2026, agent
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <elf/elf.h>
+#include <string.h>
+
+/*
+ * SHA-256 as specified in FIPS 180-4. The block function uses the SHA
+ * instructions when the compiler targets them (x86 SHA extensions, or the
+ * ARMv8 cryptography extension), otherwise it is portable C.
+ */
+#if defined(__SHA__) && defined(__SSE4_1__)
+#define ELF_SHA256_X86 1
+#include <immintrin.h>
+#elif defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO)
+#define ELF_SHA256_ARM 1
+#include <arm_neon.h>
+#endif
+
+static const uint32_t elf_sha256K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#if defined(ELF_SHA256_X86)
+
+static void elf_sha256Blocks(uint32_t state[8], const uint8_t *data, size_t blocks)
+{
+    const __m128i bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    /* The instructions keep the state as ABEF and CDGH */
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *) &state[0]), 0xb1);
+    __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *) &state[4]), 0x1b);
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xf0);
+
+    for (; blocks > 0; blocks--, data += 64) {
+        __m128i abef = state0;
+        __m128i cdgh = state1;
+        __m128i msg[4];
+        for (int i = 0; i < 4; i++) {
+            msg[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 16 * i)), bswap);
+        }
+
+        for (int i = 0; i < 16; i++) {
+            __m128i wk = _mm_add_epi32(msg[i & 3], _mm_loadu_si128((const __m128i *) &elf_sha256K[4 * i]));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, wk);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(wk, 0x0e));
+            if (i < 12) {
+                /* Schedule the words 16 rounds ahead */
+                __m128i w = _mm_add_epi32(_mm_sha256msg1_epu32(msg[i & 3], msg[(i + 1) & 3]),
+                                          _mm_alignr_epi8(msg[(i + 3) & 3], msg[(i + 2) & 3], 4));
+                msg[i & 3] = _mm_sha256msg2_epu32(w, msg[(i + 3) & 3]);
+            }
+        }
+
+        state0 = _mm_add_epi32(state0, abef);
+        state1 = _mm_add_epi32(state1, cdgh);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1b);
+    state1 = _mm_shuffle_epi32(state1, 0xb1);
+    state0 = _mm_blend_epi16(tmp, state1, 0xf0);
+    state1 = _mm_alignr_epi8(state1, tmp, 8);
+    _mm_storeu_si128((__m128i *) &state[0], state0);
+    _mm_storeu_si128((__m128i *) &state[4], state1);
+}
+
+#elif defined(ELF_SHA256_ARM)
+
+static void elf_sha256Blocks(uint32_t state[8], const uint8_t *data, size_t blocks)
+{
+    uint32x4_t state0 = vld1q_u32(&state[0]);
+    uint32x4_t state1 = vld1q_u32(&state[4]);
+
+    for (; blocks > 0; blocks--, data += 64) {
+        uint32x4_t abcd = state0;
+        uint32x4_t efgh = state1;
+        uint32x4_t msg[4];
+        for (int i = 0; i < 4; i++) {
+            msg[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16 * i)));
+        }
+
+        for (int i = 0; i < 16; i++) {
+            uint32x4_t wk = vaddq_u32(msg[i & 3], vld1q_u32(&elf_sha256K[4 * i]));
+            uint32x4_t prev = state0;
+            state0 = vsha256hq_u32(state0, state1, wk);
+            state1 = vsha256h2q_u32(state1, prev, wk);
+            if (i < 12) {
+                /* Schedule the words 16 rounds ahead */
+                msg[i & 3] = vsha256su1q_u32(vsha256su0q_u32(msg[i & 3], msg[(i + 1) & 3]),
+                                             msg[(i + 2) & 3], msg[(i + 3) & 3]);
+            }
+        }
+
+        state0 = vaddq_u32(state0, abcd);
+        state1 = vaddq_u32(state1, efgh);
+    }
+
+    vst1q_u32(&state[0], state0);
+    vst1q_u32(&state[4], state1);
+}
+
+#else
+
+#define ROTR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void elf_sha256Blocks(uint32_t state[8], const uint8_t *data, size_t blocks)
+{
+    for (; blocks > 0; blocks--, data += 64) {
+        uint32_t w[64];
+        for (int i = 0; i < 16; i++) {
+            w[i] = (uint32_t) data[4 * i] << 24 | (uint32_t) data[4 * i + 1] << 16 |
+                   (uint32_t) data[4 * i + 2] << 8 | data[4 * i + 3];
+        }
+        for (int i = 16; i < 64; i++) {
+            uint32_t s0 = ROTR32(w[i - 15], 7) ^ ROTR32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = ROTR32(w[i - 2], 17) ^ ROTR32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; i++) {
+            uint32_t t1 = h + (ROTR32(e, 6) ^ ROTR32(e, 11) ^ ROTR32(e, 25)) + ((e & f) ^ (~e & g)) +
+                          elf_sha256K[i] + w[i];
+            uint32_t t2 = (ROTR32(a, 2) ^ ROTR32(a, 13) ^ ROTR32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+}
+
+#endif
+
+void elf_sha256Init(elf_sha256_t *ctx)
+{
+    static const uint32_t initial[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+    memcpy(ctx->state, initial, sizeof(initial));
+    ctx->length = 0;
+    ctx->buf_len = 0;
+}
+
+void elf_sha256Update(elf_sha256_t *ctx, const void *data, size_t len)
+{
+    const uint8_t *pos = data;
+    ctx->length += len;
+
+    if (ctx->buf_len > 0) {
+        size_t fill = ELF_SHA256_BLOCK_SIZE - ctx->buf_len;
+        if (len < fill) {
+            memcpy(ctx->buf + ctx->buf_len, pos, len);
+            ctx->buf_len += len;
+            return;
+        }
+        memcpy(ctx->buf + ctx->buf_len, pos, fill);
+        elf_sha256Blocks(ctx->state, ctx->buf, 1);
+        ctx->buf_len = 0;
+        pos += fill;
+        len -= fill;
+    }
+
+    /* Whole blocks are hashed straight from the input */
+    size_t blocks = len / ELF_SHA256_BLOCK_SIZE;
+    elf_sha256Blocks(ctx->state, pos, blocks);
+    pos += blocks * ELF_SHA256_BLOCK_SIZE;
+    len -= blocks * ELF_SHA256_BLOCK_SIZE;
+
+    memcpy(ctx->buf, pos, len);
+    ctx->buf_len = len;
+}
+
+void elf_sha256Final(elf_sha256_t *ctx, uint8_t digest[ELF_SHA256_DIGEST_SIZE])
+{
+    uint64_t bits = ctx->length * 8;
+
+    ctx->buf[ctx->buf_len++] = 0x80;
+    if (ctx->buf_len > ELF_SHA256_BLOCK_SIZE - 8) {
+        memset(ctx->buf + ctx->buf_len, 0, ELF_SHA256_BLOCK_SIZE - ctx->buf_len);
+        elf_sha256Blocks(ctx->state, ctx->buf, 1);
+        ctx->buf_len = 0;
+    }
+    memset(ctx->buf + ctx->buf_len, 0, ELF_SHA256_BLOCK_SIZE - 8 - ctx->buf_len);
+    for (int i = 0; i < 8; i++) {
+        ctx->buf[ELF_SHA256_BLOCK_SIZE - 1 - i] = bits >> (8 * i);
+    }
+    elf_sha256Blocks(ctx->state, ctx->buf, 1);
+
+    for (int i = 0; i < 8; i++) {
+        digest[4 * i] = ctx->state[i] >> 24;
+        digest[4 * i + 1] = ctx->state[i] >> 16;
+        digest[4 * i + 2] = ctx->state[i] >> 8;
+        digest[4 * i + 3] = ctx->state[i];
+    }
+}
@@ -0,0 +1,627 @@
+/*
+ * Copyright 2026, agent
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <elf/elf.h>
+#include <elf/elf32.h>
+#include <elf/elf64.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GNU_HASH_HEADER_SIZE (4 * sizeof(uint32_t))
+#define SYSV_HASH_HEADER_SIZE (2 * sizeof(uint32_t))
+
+static uint32_t elf_gnuHash(const char *name)
+{
+    uint32_t h = 5381;
+    for (const unsigned char *c = (const unsigned char *) name; *c != '\0'; c++) {
+        h = h * 33 + *c;
+    }
+    return h;
+}
+
+static uint32_t elf_sysvHash(const char *name)
+{
+    uint32_t h = 0;
+    for (const unsigned char *c = (const unsigned char *) name; *c != '\0'; c++) {
+        h = (h << 4) + *c;
+        uint32_t g = h & 0xf0000000;
+        h ^= g >> 24;
+        h &= ~g;
+    }
+    return h;
+}
+
+/* Size of a word of the GNU hash bloom filter, which is the address size */
+static size_t elf_bloomWordSize(const elf_t *elf)
+{
+    return elf_isElf32(elf) ? sizeof(uint32_t) : sizeof(uint64_t);
+}
+
+/* Read a symbol without checking the index */
+static void elf_readSymbol(const elf_symtab_t *symtab, size_t i, elf_symbol_t *sym)
+{
+    const void *entry = symtab->symbols + i * symtab->sym_size;
+    uint32_t name;
+    unsigned char info;
+
+    if (elf_isElf32(symtab->elf)) {
+        const Elf32_Sym *s = entry;
+        name = s->st_name;
+        info = s->st_info;
+        sym->value = s->st_value;
+        sym->size = s->st_size;
+        sym->shndx = s->st_shndx;
+    } else {
+        const Elf64_Sym *s = entry;
+        name = s->st_name;
+        info = s->st_info;
+        sym->value = s->st_value;
+        sym->size = s->st_size;
+        sym->shndx = s->st_shndx;
+    }
+    sym->index = i;
+    sym->type = ELF32_ST_TYPE(info);
+    sym->bind = ELF32_ST_BIND(info);
+    sym->name = name < symtab->strings_size ? symtab->strings + name : NULL;
+}
+
+/* Check whether a symbol is a definition called name and if so return it */
+static bool elf_matchSymbol(const elf_symtab_t *symtab, size_t i, const char *name, elf_symbol_t *sym)
+{
+    elf_symbol_t candidate;
+    elf_readSymbol(symtab, i, &candidate);
+    if (candidate.name == NULL || candidate.shndx == SHN_UNDEF || strcmp(candidate.name, name) != 0) {
+        return false;
+    }
+
+    if (sym != NULL) {
+        *sym = candidate;
+    }
+    return true;
+}
+
+/* Check whether a table of size bytes holds a number of entries of entry_size */
+static bool elf_tableFits(size_t size, size_t entries, size_t entry_size)
+{
+    return entry_size == 0 || entries <= size / entry_size;
+}
+
+/*
+ * Set up the GNU hash table of symtab from the table at hash, returning the
+ * number of symbols the table covers.
+ */
+static int elf_setupGnuHash(elf_symtab_t *symtab, const void *hash, size_t size, size_t *num_symbols)
+{
+    if (size < GNU_HASH_HEADER_SIZE) {
+        return -1;
+    }
+
+    const uint32_t *header = hash;
+    uint32_t num_buckets = header[0];
+    uint32_t sym_offset = header[1];
+    uint32_t bloom_size = header[2];
+    uint32_t bloom_shift = header[3];
+    size_t word_size = elf_bloomWordSize(symtab->elf);
+    if (num_buckets == 0 || bloom_size == 0 || (bloom_size & (bloom_size - 1)) != 0) {
+        return -1; /* malformed hash table */
+    }
+
+    size = size - GNU_HASH_HEADER_SIZE;
+    if (!elf_tableFits(size, bloom_size, word_size)) {
+        return -1;
+    }
+    size -= bloom_size * word_size;
+    if (!elf_tableFits(size, num_buckets, sizeof(uint32_t))) {
+        return -1;
+    }
+    size -= num_buckets * sizeof(uint32_t);
+
+    symtab->hash = ELF_SYMTAB_GNU_HASH;
+    symtab->num_buckets = num_buckets;
+    symtab->sym_offset = sym_offset;
+    symtab->bloom_size = bloom_size;
+    symtab->bloom_shift = bloom_shift;
+    symtab->bloom = hash + GNU_HASH_HEADER_SIZE;
+    symtab->buckets = symtab->bloom + bloom_size * word_size;
+    symtab->chain = symtab->buckets + num_buckets;
+
+    /*
+     * The table does not record the number of symbols: it ends with the last
+     * entry of the chain of the highest bucket.
+     */
+    size_t chain_entries = size / sizeof(uint32_t);
+    uint32_t last = 0;
+    for (uint32_t i = 0; i < num_buckets; i++) {
+        if (symtab->buckets[i] > last) {
+            last = symtab->buckets[i];
+        }
+    }
+    if (last < sym_offset) {
+        *num_symbols = sym_offset; /* no hashed symbols */
+        return 0;
+    }
+    while (last - sym_offset < chain_entries && (symtab->chain[last - sym_offset] & 1) == 0) {
+        last++;
+    }
+    if (last - sym_offset >= chain_entries) {
+        return -1; /* chain runs past the end of the table */
+    }
+
+    *num_symbols = (size_t) last + 1;
+    return 0;
+}
+
+/* Set up the SysV hash table of symtab, returning the number of symbols it covers */
+static int elf_setupSysvHash(elf_symtab_t *symtab, const void *hash, size_t size, size_t *num_symbols)
+{
+    if (size < SYSV_HASH_HEADER_SIZE) {
+        return -1;
+    }
+
+    const uint32_t *header = hash;
+    uint32_t num_buckets = header[0];
+    uint32_t num_chain = header[1];
+    size = size - SYSV_HASH_HEADER_SIZE;
+    if (num_buckets == 0 || !elf_tableFits(size, (size_t) num_buckets + num_chain, sizeof(uint32_t))) {
+        return -1; /* malformed hash table */
+    }
+
+    symtab->hash = ELF_SYMTAB_SYSV_HASH;
+    symtab->num_buckets = num_buckets;
+    symtab->buckets = header + 2;
+    symtab->chain = symtab->buckets + num_buckets;
+    *num_symbols = num_chain;
+    return 0;
+}
+
+/* Set up the symbol and string tables of symtab from a symbol table section */
+static int elf_setupSymbolSection(elf_symtab_t *symtab, size_t i)
+{
+    const elf_t *elf = symtab->elf;
+    uint32_t type = elf_getSectionType(elf, i);
+    if (type != SHT_SYMTAB && type != SHT_DYNSYM) {
+        return -1;
+    }
+
+    const void *symbols = elf_getSection(elf, i);
+    size_t sym_size = elf_getSectionEntrySize(elf, i);
+    size_t min_size = elf_isElf32(elf) ? sizeof(Elf32_Sym) : sizeof(Elf64_Sym);
+    size_t strings_index = elf_getSectionLink(elf, i);
+    const char *strings = elf_getStringTable(elf, strings_index);
+    if (symbols == NULL || sym_size < min_size || strings == NULL) {
+        return -1;
+    }
+
+    symtab->symbols = symbols;
+    symtab->sym_size = sym_size;
+    symtab->num_symbols = elf_getSectionSize(elf, i) / sym_size;
+    symtab->strings = strings;
+    symtab->strings_size = elf_getSectionSize(elf, strings_index);
+    return 0;
+}
+
+/* Find the hash table and dynamic symbol table through the dynamic section */
+static int elf_findHashDynamic(elf_symtab_t *symtab)
+{
+    const elf_t *elf = symtab->elf;
+    uintptr_t gnu_hash = 0, sysv_hash = 0, symbols = 0, strings = 0;
+    size_t strings_size = 0, sym_size = 0;
+    elf_dyn_t dyn[16];
+    size_t count;
+    for (size_t first = 0; (count = elf_getDynamicEntries(elf, first, dyn, 16)) > 0; first += count) {
+        for (size_t i = 0; i < count; i++) {
+            switch (dyn[i].tag) {
+            case DT_GNU_HASH:
+                gnu_hash = dyn[i].value;
+                break;
+            case DT_HASH:
+                sysv_hash = dyn[i].value;
+                break;
+            case DT_SYMTAB:
+                symbols = dyn[i].value;
+                break;
+            case DT_STRTAB:
+                strings = dyn[i].value;
+                break;
+            case DT_STRSZ:
+                strings_size = dyn[i].value;
+                break;
+            case DT_SYMENT:
+                sym_size = dyn[i].value;
+                break;
+            }
+        }
+    }
+    if (gnu_hash == 0 && sysv_hash == 0) {
+        return 1; /* no hash table */
+    }
+
+    size_t strings_avail, symbols_avail, hash_avail;
+    symtab->strings = elf_getVaddrData(elf, strings, &strings_avail);
+    symtab->symbols = elf_getVaddrData(elf, symbols, &symbols_avail);
+    size_t min_size = elf_isElf32(elf) ? sizeof(Elf32_Sym) : sizeof(Elf64_Sym);
+    if (symtab->strings == NULL || strings_size == 0 || strings_avail < strings_size ||
+        symtab->strings[strings_size - 1] != '\0' || symtab->symbols == NULL || sym_size < min_size) {
+        return -1;
+    }
+    symtab->strings_size = strings_size;
+    symtab->sym_size = sym_size;
+
+    const void *hash = elf_getVaddrData(elf, gnu_hash != 0 ? gnu_hash : sysv_hash, &hash_avail);
+    if (hash == NULL) {
+        return -1;
+    }
+    size_t num_symbols;
+    int error = gnu_hash != 0 ? elf_setupGnuHash(symtab, hash, hash_avail, &num_symbols)
+                : elf_setupSysvHash(symtab, hash, hash_avail, &num_symbols);
+    if (error) {
+        return error;
+    }
+    if (!elf_tableFits(symbols_avail, num_symbols, sym_size)) {
+        return -1; /* hash table refers to symbols past the symbol table */
+    }
+    symtab->num_symbols = num_symbols;
+
+    return 0;
+}
+
+/* Find the first section of a type, returns 0 if there is none */
+static size_t elf_findSectionByType(const elf_t *elf, uint32_t type)
+{
+    size_t num_sections = elf_getNumSections(elf);
+    for (size_t i = 0; i < num_sections; i++) {
+        if (elf_getSectionType(elf, i) == type) {
+            return i;
+        }
+    }
+
+    return 0;
+}
+
+/* Find the complete symbol table: .symtab, or .dynsym if there is no .symtab */
+static int elf_findIndexSection(elf_symtab_t *symtab)
+{
+    size_t section = elf_findSectionByType(symtab->elf, SHT_SYMTAB);
+    if (section == 0) {
+        section = elf_findSectionByType(symtab->elf, SHT_DYNSYM);
+    }
+    if (section == 0) {
+        return 1; /* no symbol table */
+    }
+
+    return elf_setupSymbolSection(symtab, section);
+}
+
+/*
+ * Find the symbol table and hash table of an ELF file, without building the
+ * index. Returns 1 if the ELF file has no symbol table of the scope.
+ */
+static int elf_findSymbolTable(const elf_t *elf, elf_symtab_scope_t scope, elf_symtab_t *symtab)
+{
+    *symtab = (elf_symtab_t) {
+        .elf = elf,
+    };
+
+    /* The hash tables of the dynamic section only cover .dynsym */
+    size_t section = scope == ELF_SYMTAB_ALL ? elf_findSectionByType(elf, SHT_SYMTAB) : 0;
+    int error = section != 0 ? 1 : elf_findHashDynamic(symtab);
+    if (error > 0) {
+        if (section == 0) {
+            section = elf_findSectionByType(elf, SHT_DYNSYM);
+        }
+        if (section == 0) {
+            return 1; /* no symbol table */
+        }
+        symtab->hash = ELF_SYMTAB_INDEX;
+        error = elf_setupSymbolSection(symtab, section);
+        if (error == 0 && symtab->num_symbols > UINT32_MAX) {
+            return -1; /* too many symbols for the index */
+        }
+        /* Aim for chains of two symbols */
+        symtab->num_buckets = symtab->num_symbols / 2 + 1;
+    }
+
+    return error;
+}
+
+size_t elf_getSymbolIndexSize(const elf_t *elf, elf_symtab_scope_t scope)
+{
+    elf_symtab_t symtab;
+    if (elf_findSymbolTable(elf, scope, &symtab) != 0 || symtab.hash != ELF_SYMTAB_INDEX) {
+        return 0;
+    }
+
+    return (symtab.num_buckets + symtab.num_symbols) * sizeof(uint32_t);
+}
+
+int elf_newSymbolTable(const elf_t *elf, elf_symtab_scope_t scope, void *buf, size_t buf_size, elf_symtab_t *res)
+{
+    elf_symtab_t symtab;
+    int error = elf_findSymbolTable(elf, scope, &symtab);
+    if (error) {
+        return -1;
+    }
+
+    if (symtab.hash == ELF_SYMTAB_INDEX) {
+        size_t size = (symtab.num_buckets + symtab.num_symbols) * sizeof(uint32_t);
+        if (buf == NULL || buf_size < size || ((uintptr_t) buf & (sizeof(uint32_t) - 1)) != 0) {
+            return -1;
+        }
+
+        uint32_t *buckets = buf;
+        uint32_t *chain = buckets + symtab.num_buckets;
+        memset(buckets, 0, symtab.num_buckets * sizeof(uint32_t));
+
+        /*
+         * Insert in reverse so that each chain is in index order. Index 0 is
+         * the null symbol, which also terminates the chains.
+         */
+        for (size_t i = symtab.num_symbols; i-- > 1;) {
+            elf_symbol_t sym;
+            elf_readSymbol(&symtab, i, &sym);
+            if (sym.name == NULL || sym.name[0] == '\0' || sym.shndx == SHN_UNDEF) {
+                continue;
+            }
+
+            uint32_t bucket = elf_gnuHash(sym.name) % symtab.num_buckets;
+            chain[i] = buckets[bucket];
+            buckets[bucket] = i;
+        }
+        symtab.buckets = buckets;
+        symtab.chain = chain;
+    }
+
+    if (res) {
+        *res = symtab;
+    }
+
+    return 0;
+}
+
+size_t elf_getNumSymbols(const elf_symtab_t *symtab)
+{
+    return symtab->num_symbols;
+}
+
+int elf_getSymbol(const elf_symtab_t *symtab, size_t i, elf_symbol_t *sym)
+{
+    if (i >= symtab->num_symbols) {
+        return -1;
+    }
+
+    elf_readSymbol(symtab, i, sym);
+    return 0;
+}
+
+static int elf_lookupGnuHash(const elf_symtab_t *symtab, const char *name, elf_symbol_t *sym)
+{
+    uint32_t hash = elf_gnuHash(name);
+
+    /* The bloom filter rejects most missing symbols without touching the buckets */
+    size_t word_bits = elf_bloomWordSize(symtab->elf) * 8;
+    size_t word = (hash / word_bits) & (symtab->bloom_size - 1);
+    uint64_t bits;
+    if (word_bits == 32) {
+        bits = ((const uint32_t *) symtab->bloom)[word];
+    } else {
+        bits = ((const uint64_t *) symtab->bloom)[word];
+    }
+    uint64_t mask = ((uint64_t) 1 << (hash % word_bits)) |
+                    ((uint64_t) 1 << ((hash >> symtab->bloom_shift) % word_bits));
+    if ((bits & mask) != mask) {
+        return -1;
+    }
+
+    size_t i = symtab->buckets[hash % symtab->num_buckets];
+    if (i < symtab->sym_offset) {
+        return -1; /* empty bucket */
+    }
+
+    for (; i < symtab->num_symbols; i++) {
+        uint32_t chain_hash = symtab->chain[i - symtab->sym_offset];
+        if ((chain_hash | 1) == (hash | 1) && elf_matchSymbol(symtab, i, name, sym)) {
+            return 0;
+        }
+        if (chain_hash & 1) {
+            break; /* end of chain */
+        }
+    }
+
+    return -1;
+}
+
+static int elf_lookupChain(const elf_symtab_t *symtab, uint32_t hash, const char *name, elf_symbol_t *sym)
+{
+    size_t i = symtab->buckets[hash % symtab->num_buckets];
+
+    /* Bound the walk in case the chains of the ELF file contain a cycle */
+    for (size_t steps = 0; i != STN_UNDEF && i < symtab->num_symbols && steps < symtab->num_symbols; steps++) {
+        if (elf_matchSymbol(symtab, i, name, sym)) {
+            return 0;
+        }
+        i = symtab->chain[i];
+    }
+
+    return -1;
+}
+
+int elf_lookupSymbol(const elf_symtab_t *symtab, const char *name, elf_symbol_t *sym)
+{
+    switch (symtab->hash) {
+    case ELF_SYMTAB_GNU_HASH:
+        return elf_lookupGnuHash(symtab, name, sym);
+    case ELF_SYMTAB_SYSV_HASH:
+        return elf_lookupChain(symtab, elf_sysvHash(name), name, sym);
+    case ELF_SYMTAB_INDEX:
+        return elf_lookupChain(symtab, elf_gnuHash(name), name, sym);
+    }
+
+    return -1;
+}
+
+
+/* Symbolizer functions */
+
+void elf_symbolizerInit(elf_symbolizer_t *symbolizer, elf_symbolizer_image_t *images, size_t max_images,
+                        elf_symbolizer_range_t *ranges, size_t max_ranges)
+{
+    *symbolizer = (elf_symbolizer_t) {
+        .images = images,
+        .max_images = max_images,
+        .ranges = ranges,
+        .max_ranges = max_ranges,
+    };
+}
+
+static bool elf_isFunctionSymbol(const elf_symbol_t *sym)
+{
+    return (sym->type == STT_FUNC || sym->type == STT_GNU_IFUNC) && sym->shndx != SHN_UNDEF &&
+           sym->name != NULL && sym->name[0] != '\0';
+}
+
+size_t elf_getSymbolizerRanges(const elf_t *elf)
+{
+    elf_symtab_t symtab = {
+        .elf = elf,
+    };
+    if (elf_findIndexSection(&symtab) != 0) {
+        return 0;
+    }
+
+    size_t count = 0;
+    for (size_t i = 1; i < symtab.num_symbols; i++) {
+        elf_symbol_t sym;
+        elf_readSymbol(&symtab, i, &sym);
+        if (elf_isFunctionSymbol(&sym)) {
+            count++;
+        }
+    }
+    return count;
+}
+
+static int elf_compareRanges(const void *a, const void *b)
+{
+    const elf_symbolizer_range_t *range_a = a;
+    const elf_symbolizer_range_t *range_b = b;
+    if (range_a->start != range_b->start) {
+        return range_a->start < range_b->start ? -1 : 1;
+    }
+    /* Of several symbols at the same address prefer the largest */
+    if (range_a->size != range_b->size) {
+        return range_a->size > range_b->size ? -1 : 1;
+    }
+    return range_a->name < range_b->name ? -1 : range_a->name > range_b->name;
+}
+
+int elf_symbolizerAddImage(elf_symbolizer_t *symbolizer, const elf_t *elf, size_t *image)
+{
+    if (symbolizer->num_images == symbolizer->max_images) {
+        return -1;
+    }
+
+    elf_symtab_t symtab = {
+        .elf = elf,
+    };
+    if (elf_findIndexSection(&symtab) != 0) {
+        return -1;
+    }
+
+    /* Bit 0 of the value of an ARM function symbol marks Thumb code, it is not part of the address */
+    uintptr_t addr_mask = elf_getMachine(elf) == EM_ARM ? ~(uintptr_t) 1 : ~(uintptr_t) 0;
+
+    elf_symbolizer_range_t *ranges = symbolizer->ranges + symbolizer->num_ranges;
+    size_t max_ranges = symbolizer->max_ranges - symbolizer->num_ranges;
+    size_t count = 0;
+    for (size_t i = 1; i < symtab.num_symbols; i++) {
+        elf_symbol_t sym;
+        elf_readSymbol(&symtab, i, &sym);
+        if (!elf_isFunctionSymbol(&sym)) {
+            continue;
+        }
+        if (count == max_ranges) {
+            return -1;
+        }
+
+        ranges[count++] = (elf_symbolizer_range_t) {
+            .start = sym.value & addr_mask,
+            .size = sym.size > UINT32_MAX ? UINT32_MAX : sym.size,
+            .name = sym.name - symtab.strings,
+        };
+    }
+
+    qsort(ranges, count, sizeof(*ranges), elf_compareRanges);
+
+    /*
+     * Drop aliases, keeping the first symbol at each address. Symbols without
+     * a size, usually from assembly, extend to the next symbol.
+     */
+    size_t unique = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (unique > 0 && ranges[unique - 1].start == ranges[i].start) {
+            continue;
+        }
+        ranges[unique++] = ranges[i];
+    }
+    for (size_t i = 0; i + 1 < unique; i++) {
+        uintptr_t gap = ranges[i + 1].start - ranges[i].start;
+        if (ranges[i].size == 0) {
+            ranges[i].size = gap > UINT32_MAX ? UINT32_MAX : gap;
+        }
+    }
+
+    size_t id = symbolizer->num_images++;
+    symbolizer->images[id] = (elf_symbolizer_image_t) {
+        .strings = symtab.strings,
+        .first = symbolizer->num_ranges,
+        .count = unique,
+    };
+    symbolizer->num_ranges += unique;
+
+    if (image != NULL) {
+        *image = id;
+    }
+    return 0;
+}
+
+int elf_symbolize(const elf_symbolizer_t *symbolizer, size_t image, uintptr_t addr, const char **name,
+                  size_t *offset)
+{
+    if (image >= symbolizer->num_images) {
+        return -1;
+    }
+
+    const elf_symbolizer_image_t *img = &symbolizer->images[image];
+    const elf_symbolizer_range_t *ranges = symbolizer->ranges + img->first;
+
+    /* Find the last range starting at or below addr */
+    size_t low = 0;
+    size_t high = img->count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (ranges[mid].start <= addr) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    if (low == 0) {
+        return -1;
+    }
+
+    const elf_symbolizer_range_t *range = &ranges[low - 1];
+    uintptr_t delta = addr - range->start;
+    if (delta >= range->size && !(delta == 0 && range->size == 0)) {
+        return -1; /* between functions */
+    }
+
+    if (name != NULL) {
+        *name = img->strings + range->name;
+    }
+    if (offset != NULL) {
+        *offset = delta;
+    }
+    return 0;
+}
@@ -53,3 +53,34 @@ typedef struct {
     const char **compatible_list;
     ps_driver_init_fn_t init;
 } ps_driver_module_t;
+
+/*
+ * Probes the FDT for devices handled by a set of driver modules, and calls the
+ * init function of each module once for every node that is compatible with one
+ * of the strings of its compatible list, passing the path of the node.
+ *
+ * The tree is walked once, and each entry of the 'compatible' property of a node
+ * is looked up in a hash table of the compatible strings of all the modules. Init
+ * functions that return PS_DRIVER_INIT_DEFER are called again after the other
+ * matches have been initialised, for as long as that makes progress.
+ *
+ * Indexing the FDT with ps_fdt_index_init beforehand makes getting the paths of
+ * the matched nodes cheaper.
+ *
+ * @param io_ops An initialised IO ops interface, with an IO FDT and a malloc interface.
+ * @param modules Array of pointers to the driver modules.
+ * @param num_modules Number of driver modules.
+ *
+ * @returns 0 on success, otherwise -EINVAL, -ENOMEM, -EAGAIN if some init functions
+ * kept deferring, the first error returned by an init function or one of the error codes in libfdt
+ */
+int ps_driver_modules_probe(ps_io_ops_t *io_ops, ps_driver_module_t **modules, size_t num_modules);
+
+/*
+ * Calls ps_driver_modules_probe with all the modules registered with PS_DRIVER_MODULE_DEFINE.
+ *
+ * @param io_ops An initialised IO ops interface, with an IO FDT and a malloc interface.
+ *
+ * @returns As ps_driver_modules_probe
+ */
+int ps_driver_modules_probe_all(ps_io_ops_t *io_ops);
@@ -15,8 +15,8 @@
  * RISCV does have 128 bits but there are no platforms that use that bit length (yet) */
 #define READ_CELL32(addr) fdt32_ld(addr)
 #define READ_CELL64(addr) fdt64_ld(addr)
-#define READ_CELL(size, addr, offset) (size == 2 ? READ_CELL64(addr + (offset * sizeof(uint32_t))) : \
-                                                   READ_CELL32(addr + (offset * sizeof(uint32_t))))
+#define READ_CELL(size, addr, offset) ((size) == 2 ? READ_CELL64((addr) + ((offset) * sizeof(uint32_t))) : \
+                                                     READ_CELL32((addr) + ((offset) * sizeof(uint32_t))))
 
 /*
  * Type of the callback function that is called for each device register instance
@@ -68,11 +68,236 @@ int ps_fdt_read_path(ps_io_fdt_t *io_fdt, ps_malloc_ops_t *malloc_ops, const cha
  */
 int ps_fdt_cleanup_cookie(ps_malloc_ops_t *malloc_ops, ps_fdt_cookie_t *cookie);
 
+/*
+ * Builds a structural index of the FDT in one pass over the blob. Afterwards the
+ * parent, depth, child, cell and phandle queries below no longer need to walk the
+ * tree from the root, and are used by the other functions in this library. Without
+ * an index, they fall back to the equivalent libfdt functions, so the walkers
+ * behave as they always did unless the blob was indexed.
+ *
+ * The index is kept in a table of this library keyed by the blob returned by the
+ * IO FDT interface, rather than in the interface itself, and is used by any
+ * interface that returns the same blob. It must be rebuilt if the blob is modified,
+ * and freed before the blob is. The table is not synchronised, so indices must not
+ * be built or freed while other threads use the FDT.
+ *
+ * @param io_fdt An initialised IO FDT interface.
+ * @param malloc_ops An initialised malloc interface.
+ *
+ * @returns 0 on success, otherwise -EINVAL, -ENOMEM, or one of the error codes in libfdt
+ */
+int ps_fdt_index_init(ps_io_fdt_t *io_fdt, ps_malloc_ops_t *malloc_ops);
+
+/*
+ * Frees the index built by ps_fdt_index_init for the blob of an IO FDT interface.
+ *
+ * @param io_fdt An initialised IO FDT interface.
+ * @param malloc_ops The malloc interface that the index was allocated with.
+ *
+ * @returns 0 on success, otherwise -EINVAL
+ */
+int ps_fdt_index_cleanup(ps_io_fdt_t *io_fdt, ps_malloc_ops_t *malloc_ops);
+
+/*
+ * Equivalents of fdt_parent_offset, fdt_node_depth, fdt_first_subnode,
+ * fdt_next_subnode, fdt_address_cells and fdt_size_cells that use the index
+ * of the blob of the IO FDT interface, if there is one.
+ *
+ * @param io_fdt An initialised IO FDT interface.
+ * @param node_offset Offset of a node in the FDT.
+ *
+ * @returns The result of the libfdt function, or -EINVAL
+ */
+int ps_fdt_parent_offset(ps_io_fdt_t *io_fdt, int node_offset);
+int ps_fdt_node_depth(ps_io_fdt_t *io_fdt, int node_offset);
+int ps_fdt_first_subnode(ps_io_fdt_t *io_fdt, int node_offset);
+int ps_fdt_next_subnode(ps_io_fdt_t *io_fdt, int node_offset);
+int ps_fdt_address_cells(ps_io_fdt_t *io_fdt, int node_offset);
+int ps_fdt_size_cells(ps_io_fdt_t *io_fdt, int node_offset);
+
+/*
+ * Equivalent of fdt_node_offset_by_phandle that uses the phandle table of the
+ * index of the blob of the IO FDT interface, if there is one. Interrupt, clock, GPIO and
+ * other phandle references should be resolved with this function.
+ *
+ * @param io_fdt An initialised IO FDT interface.
+ * @param phandle Phandle of the node.
+ *
+ * @returns The offset of the node, otherwise one of the error codes in libfdt or -EINVAL
+ */
+int ps_fdt_node_offset_by_phandle(ps_io_fdt_t *io_fdt, uint32_t phandle);
+
+/*
+ * Equivalent of fdt_get_path that follows the parent links of the index of the
+ * blob of the IO FDT interface, if there is one, rather than scanning the blob up
+ * to the node.
+ *
+ * @param io_fdt An initialised IO FDT interface.
+ * @param node_offset Offset of a node in the FDT.
+ * @param buf Storage that the path of the node is written to.
+ * @param buflen Size of the storage.
+ *
+ * @returns 0 on success, otherwise one of the error codes in libfdt or -EINVAL
+ */
+int ps_fdt_get_path(ps_io_fdt_t *io_fdt, int node_offset, char *buf, int buflen);
+
+/* A property of an unflattened FDT */
+typedef struct ps_fdt_prop {
+    /* Interned, so properties with the same name share the same pointer */
+    const char *name;
+    /* Points into the blob */
+    const void *value;
+    int len;
+} ps_fdt_prop_t;
+
+/* A node of an unflattened FDT, the links are NULL if there is no such node */
+typedef struct ps_fdt_node {
+    const char *name;
+    int offset;
+    struct ps_fdt_node *parent;
+    struct ps_fdt_node *first_child;
+    struct ps_fdt_node *next_sibling;
+    ps_fdt_prop_t *props;
+    uint32_t num_props;
+    /* Open addressing hash table of the properties by interned name, holding indices + 1 */
+    uint32_t *prop_table;
+    uint32_t prop_table_mask;
+} ps_fdt_node_t;
+
+/* An unflattened FDT, held in a single allocation */
+typedef struct ps_fdt_tree {
+    /* The blob that was unflattened, which the names and values point into */
+    const void *dtb_blob;
+    /* The tree of another blob */
+    struct ps_fdt_tree *next;
+    size_t alloc_size;
+    /* In the order of the blob, the first one is the root */
+    ps_fdt_node_t *nodes;
+    int num_nodes;
+    /* Open addressing hash table of the interned property names */
+    const char **names;
+    uint32_t names_mask;
+} ps_fdt_tree_t;
+
+/*
+ * Unflattens the FDT into a graph of nodes and properties, after which
+ * ps_fdt_getprop looks properties up by hash instead of scanning the properties
+ * of a node. Property values are not copied, so the blob must outlive the tree.
+ * Like the index, the tree is kept in a table keyed by the blob, must be rebuilt
+ * if the blob is modified, and freed before the blob is.
+ *
+ * @param io_fdt An initialised IO FDT interface.
+ * @param malloc_ops An initialised malloc interface.
+ *
+ * @returns 0 on success, otherwise -EINVAL, -ENOMEM, or one of the error codes in libfdt
+ */
+int ps_fdt_unflatten(ps_io_fdt_t *io_fdt, ps_malloc_ops_t *malloc_ops);
+
+/*
+ * Frees the tree built by ps_fdt_unflatten for the blob of an IO FDT interface.
+ *
+ * @param io_fdt An initialised IO FDT interface.
+ * @param malloc_ops The malloc interface that the tree was allocated with.
+ *
+ * @returns 0 on success, otherwise -EINVAL
+ */
+int ps_fdt_unflatten_cleanup(ps_io_fdt_t *io_fdt, ps_malloc_ops_t *malloc_ops);
+
+/*
+ * Returns the tree built by ps_fdt_unflatten for the blob of an IO FDT interface.
+ *
+ * @param io_fdt An initialised IO FDT interface.
+ *
+ * @returns The tree, NULL if the blob has not been unflattened
+ */
+const ps_fdt_tree_t *ps_fdt_get_tree(ps_io_fdt_t *io_fdt);
+
+/*
+ * Returns the unflattened node at an offset of the blob.
+ *
+ * @param tree An unflattened FDT.
+ * @param node_offset Offset of a node in the FDT.
+ *
+ * @returns The node, NULL if there is no node at the offset
+ */
+const ps_fdt_node_t *ps_fdt_tree_node(const ps_fdt_tree_t *tree, int node_offset);
+
+/*
+ * Returns the interned copy of a property name, which can be looked up in the
+ * nodes of the tree with ps_fdt_node_getprop.
+ *
+ * @param tree An unflattened FDT.
+ * @param name Name of a property.
+ *
+ * @returns The interned name, NULL if no node of the tree has such a property
+ */
+const char *ps_fdt_tree_intern(const ps_fdt_tree_t *tree, const char *name);
+
+/*
+ * Looks up a property of an unflattened node.
+ *
+ * @param node An unflattened node.
+ * @param interned_name A name returned by ps_fdt_tree_intern.
+ *
+ * @returns The property, NULL if the node has no such property
+ */
+const ps_fdt_prop_t *ps_fdt_node_getprop(const ps_fdt_node_t *node, const char *interned_name);
+
+/*
+ * Equivalent of fdt_getprop that uses the unflattened tree of the blob of the IO
+ * FDT interface, if there is one.
+ *
+ * @param io_fdt An initialised IO FDT interface.
+ * @param node_offset Offset of a node in the FDT.
+ * @param name Name of the property.
+ * @param lenp Storage for the length of the property, or the error code. Can be NULL.
+ *
+ * @returns A pointer to the value of the property, NULL on error
+ */
+const void *ps_fdt_getprop(ps_io_fdt_t *io_fdt, int node_offset, const char *name, int *lenp);
+
+/*
+ * Translates an address in the address space of the parent of a node, such as one
+ * of its registers, into a CPU physical address by following the 'ranges' properties
+ * of the buses above it. A bus without a 'ranges' property cannot be translated
+ * through, an empty one is an identity mapping. Addresses and sizes of at most two
+ * cells are supported. If the FDT is indexed, the properties are parsed once for
+ * each bus node when the index is built.
+ *
+ * @param io_fdt An initialised IO FDT interface.
+ * @param node_offset Offset of the node that the address belongs to.
+ * @param bus_addr The address to translate.
+ * @param ret_addr Storage that the translated address is written to.
+ *
+ * @returns 0 on success, otherwise -EINVAL, -FDT_ERR_NOTFOUND if the node is the root
+ * node or a bus does not map the address, or another of the error codes in libfdt
+ */
+int ps_fdt_translate_address(ps_io_fdt_t *io_fdt, int node_offset, uint64_t bus_addr, uint64_t *ret_addr);
+
+/*
+ * Translates an address that a node uses for DMA into a CPU physical address by
+ * following the 'dma-ranges' properties of the buses above it, like
+ * ps_fdt_translate_address. Buses without a 'dma-ranges' property do not translate
+ * the address.
+ *
+ * @param io_fdt An initialised IO FDT interface.
+ * @param node_offset Offset of the node that the address belongs to.
+ * @param dma_addr The address to translate.
+ * @param ret_addr Storage that the translated address is written to.
+ *
+ * @returns As ps_fdt_translate_address
+ */
+int ps_fdt_translate_dma_address(ps_io_fdt_t *io_fdt, int node_offset, uint64_t dma_addr, uint64_t *ret_addr);
+
 /*
  * Walks the registers property of the device node (if any) corresponding to the
  * cookie passed in and calls a callback function at each register instance of
  * the field.
  *
+ * The base addresses of the registers are translated into CPU physical addresses
+ * with ps_fdt_translate_address. If a bus above the device cannot translate them,
+ * the address in the 'reg' property is passed on as is.
+ *
  * @param io_fdt An initialised IO FDT interface.
  * @param cookie A pointer to a initialised cookie.
  * @param callback Pointer to a callback function that is called at each register instance of the property.
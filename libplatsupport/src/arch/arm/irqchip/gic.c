@@ -32,7 +32,7 @@ typedef enum {
 /* Note for extended interrupts, we expect the common case that the interrupt controller phandles
  * for each block in the property is the same as the GICs phandle */
 static int parse_arm_gic_interrupts(char *dtb_blob, int node_offset, int intr_controller_phandle,
-                                    irq_walk_cb_fn_t callback, void *token)
+                                    int intr_controller_offset, irq_walk_cb_fn_t callback, void *token)
 {
     bool is_extended = false;
     int prop_len = 0;
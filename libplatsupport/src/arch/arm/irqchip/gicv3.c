@@ -46,7 +46,7 @@ typedef enum {
 /* Note for extended interrupts, we expect the common case that the interrupt controller phandles
  * for each block in the property is the same as the v3 GIC's phandle */
 static int parse_arm_gicv3_interrupts(char *dtb_blob, int node_offset, int intr_controller_phandle,
-                                      irq_walk_cb_fn_t callback, void *token)
+                                      int intr_controller_offset, irq_walk_cb_fn_t callback, void *token)
 {
     bool is_extended = false;
     int prop_len = 0;
@@ -58,11 +58,6 @@ static int parse_arm_gicv3_interrupts(char *dtb_blob, int node_offset, int intr_
      * Check for the number of interrupt cells, two cases: either 3 or 4. The extra cell describes PPI
      * affinity if the interrupt is a PPI interrupt.
      */
-    int intr_controller_offset = fdt_node_offset_by_phandle(dtb_blob, intr_controller_phandle);
-    if (intr_controller_offset < 0) {
-        ZF_LOGE("Can't find the interrupt controller's node offset");
-        return intr_controller_offset;
-    }
     const void *interrupt_cells_prop = fdt_getprop(dtb_blob, intr_controller_offset, "#interrupt-cells", NULL);
     if (!interrupt_cells_prop) {
         ZF_LOGE("No '#interrupt-cells' property!");
@@ -14,7 +14,7 @@
 #define TI_OMAP3_INT_CELL_COUNT 1
 
 static int parse_ti_omap3_interrupts(char *dtb_blob, int node_offset, int intr_controller_phandle,
-                                     irq_walk_cb_fn_t callback, void *token)
+                                     int intr_controller_offset, irq_walk_cb_fn_t callback, void *token)
 {
     bool is_extended = false;
     int prop_len = 0;
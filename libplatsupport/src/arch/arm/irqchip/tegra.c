@@ -22,7 +22,7 @@ extern ps_irqchip_t *__stop__ps_irqchips[];
 #define ARM_GIC_COMPAT_STRLEN sizeof(ARM_GIC_COMPAT_STRING)
 
 static int parse_tegra_ictlr_interrupts(char *dtb_blob, int node_offset, int intr_controller_phandle,
-                                        irq_walk_cb_fn_t callback, void *token)
+                                        int intr_controller_offset, irq_walk_cb_fn_t callback, void *token)
 {
     /* Look for the ARM GIC parser module and call their function.
      *
@@ -35,7 +35,8 @@ static int parse_tegra_ictlr_interrupts(char *dtb_blob, int node_offset, int int
             size_t compare_length = (compat_str_len < ARM_GIC_COMPAT_STRLEN) ? compat_str_len
                                     : ARM_GIC_COMPAT_STRLEN;
             if (strncmp(ARM_GIC_COMPAT_STRING, *compatible_str, compare_length)) {
-                return (*irqchip)->parser_fn(dtb_blob, node_offset, intr_controller_phandle, callback, token);
+                return (*irqchip)->parser_fn(dtb_blob, node_offset, intr_controller_phandle,
+                                             intr_controller_offset, callback, token);
             }
         }
     }
@@ -25,7 +25,7 @@
  */
 
 static int parse_riscv_plic_interrupts(char *dtb_blob, int node_offset, int intr_controller_phandle,
-                                       irq_walk_cb_fn_t callback, void *token)
+                                       int intr_controller_offset, irq_walk_cb_fn_t callback, void *token)
 {
     bool is_extended = false;
     int prop_len = 0;
@@ -39,11 +39,6 @@ static int parse_riscv_plic_interrupts(char *dtb_blob, int node_offset, int intr
     }
 
     /* Make sure that the interrupt we are parsing is 1-cell format */
-    int intr_controller_offset = fdt_node_offset_by_phandle(dtb_blob, intr_controller_phandle);
-    if (intr_controller_offset < 0) {
-        ZF_LOGE("Can't find the interrupt controller's node offset");
-        return intr_controller_offset;
-    }
     const void *interrupt_cells_prop = fdt_getprop(dtb_blob, intr_controller_offset, "#interrupt-cells", NULL);
     if (!interrupt_cells_prop) {
         ZF_LOGE("No '#interrupt-cells' property!");
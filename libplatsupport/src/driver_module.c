@@ -0,0 +1,252 @@
+/*
+ * Copyright 2026, agent
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <platsupport/driver_module.h>
+#include <platsupport/fdt.h>
+
+/* Force the _driver_modules section to be created even if no modules are defined. */
+static USED SECTION("_driver_modules") struct {} dummy_driver_modules;
+/* Definitions so that we can find the registered driver modules */
+extern ps_driver_module_t *__start__driver_modules[];
+extern ps_driver_module_t *__stop__driver_modules[];
+
+/* Longest path of a device node that is passed to an init function */
+#define PROBE_PATH_LEN 256
+
+/* A compatible string of a driver module, a NULL string marks an empty slot */
+typedef struct probe_entry {
+    const char *compatible;
+    uint32_t hash;
+    uint32_t module;
+} probe_entry_t;
+
+/* A node and a module that is compatible with it */
+typedef struct probe_match {
+    int node_offset;
+    uint32_t module;
+    bool done;
+} probe_match_t;
+
+typedef struct probe_state {
+    ps_malloc_ops_t *malloc_ops;
+    /* Open addressing hash table with a power of two number of slots */
+    probe_entry_t *table;
+    uint32_t table_mask;
+    /* The last node that each module matched, to match each node only once */
+    int *last_node;
+    probe_match_t *matches;
+    size_t num_matches;
+    size_t max_matches;
+} probe_state_t;
+
+/* FNV-1a */
+static uint32_t compatible_hash(const char *str, size_t len)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (uint8_t) str[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static int add_match(probe_state_t *state, int node_offset, uint32_t module)
+{
+    if (state->num_matches == state->max_matches) {
+        size_t max_matches = state->max_matches ? state->max_matches * 2 : 16;
+        probe_match_t *matches = NULL;
+        int error = ps_calloc(state->malloc_ops, max_matches, sizeof(*matches), (void **) &matches);
+        if (error) {
+            return -ENOMEM;
+        }
+        if (state->matches) {
+            memcpy(matches, state->matches, state->num_matches * sizeof(*matches));
+            ZF_LOGF_IF(ps_free(state->malloc_ops, state->max_matches * sizeof(*matches), state->matches),
+                       "Failed to free the driver probe matches");
+        }
+        state->matches = matches;
+        state->max_matches = max_matches;
+    }
+
+    state->matches[state->num_matches++] = (probe_match_t) {
+        .node_offset = node_offset,
+        .module = module,
+    };
+    return 0;
+}
+
+static int match_node(probe_state_t *state, ps_io_fdt_t *io_fdt, int node_offset)
+{
+    int prop_len = 0;
+    const char *compatible = ps_fdt_getprop(io_fdt, node_offset, "compatible", &prop_len);
+    if (!compatible) {
+        return 0;
+    }
+
+    /* The property is a list of NUL terminated strings */
+    const char *end = compatible + prop_len;
+    while (compatible < end) {
+        const char *nul = memchr(compatible, '\0', end - compatible);
+        size_t len = nul ? nul - compatible : end - compatible;
+        uint32_t hash = compatible_hash(compatible, len);
+
+        for (uint32_t i = hash & state->table_mask; state->table[i].compatible; i = (i + 1) & state->table_mask) {
+            probe_entry_t *entry = &state->table[i];
+            if (entry->hash != hash || strncmp(entry->compatible, compatible, len) != 0 ||
+                entry->compatible[len] != '\0' || state->last_node[entry->module] == node_offset) {
+                continue;
+            }
+            state->last_node[entry->module] = node_offset;
+            int error = add_match(state, node_offset, entry->module);
+            if (error) {
+                return error;
+            }
+        }
+
+        compatible += len + 1;
+    }
+
+    return 0;
+}
+
+static int dispatch_matches(probe_state_t *state, ps_io_ops_t *io_ops, ps_driver_module_t **modules)
+{
+    char path[PROBE_PATH_LEN];
+    int ret = 0;
+    size_t pending = state->num_matches;
+    bool progress = true;
+
+    /* Keep calling the deferred init functions for as long as others succeed */
+    while (pending > 0 && progress) {
+        progress = false;
+        for (size_t i = 0; i < state->num_matches; i++) {
+            probe_match_t *match = &state->matches[i];
+            if (match->done) {
+                continue;
+            }
+
+            int error = ps_fdt_get_path(&io_ops->io_fdt, match->node_offset, path, sizeof(path));
+            if (!error) {
+                error = modules[match->module]->init(io_ops, path);
+                if (error == PS_DRIVER_INIT_DEFER) {
+                    continue;
+                }
+            }
+            if (error < 0) {
+                ZF_LOGE("Failed to initialise the device at offset %d: %d", match->node_offset, error);
+                if (!ret) {
+                    ret = error;
+                }
+            }
+            match->done = true;
+            pending--;
+            progress = true;
+        }
+    }
+
+    if (pending > 0) {
+        ZF_LOGE("%zu device(s) kept deferring their initialisation", pending);
+        if (!ret) {
+            ret = -EAGAIN;
+        }
+    }
+
+    return ret;
+}
+
+int ps_driver_modules_probe(ps_io_ops_t *io_ops, ps_driver_module_t **modules, size_t num_modules)
+{
+    if (!io_ops || (!modules && num_modules > 0)) {
+        return -EINVAL;
+    }
+
+    char *dtb_blob = ps_io_fdt_get(&io_ops->io_fdt);
+    if (!dtb_blob) {
+        return -EINVAL;
+    }
+
+    size_t num_strings = 0;
+    for (size_t i = 0; i < num_modules; i++) {
+        for (const char **compatible = modules[i]->compatible_list; *compatible; compatible++) {
+            num_strings++;
+        }
+    }
+    if (num_strings == 0) {
+        return 0;
+    }
+
+    /* Keep the table at most half full */
+    size_t table_size = 1;
+    while (table_size < 2 * num_strings) {
+        table_size *= 2;
+    }
+
+    probe_state_t state = {
+        .malloc_ops = &io_ops->malloc_ops,
+        .table_mask = table_size - 1,
+    };
+    int error = ps_calloc(state.malloc_ops, table_size, sizeof(*state.table), (void **) &state.table);
+    if (error) {
+        return -ENOMEM;
+    }
+    error = ps_calloc(state.malloc_ops, num_modules, sizeof(*state.last_node), (void **) &state.last_node);
+    if (error) {
+        ZF_LOGF_IF(ps_free(state.malloc_ops, table_size * sizeof(*state.table), state.table),
+                   "Failed to free the driver probe table");
+        return -ENOMEM;
+    }
+
+    for (size_t i = 0; i < num_modules; i++) {
+        state.last_node[i] = -1;
+        for (const char **compatible = modules[i]->compatible_list; *compatible; compatible++) {
+            uint32_t hash = compatible_hash(*compatible, strlen(*compatible));
+            uint32_t slot = hash & state.table_mask;
+            while (state.table[slot].compatible) {
+                slot = (slot + 1) & state.table_mask;
+            }
+            state.table[slot] = (probe_entry_t) {
+                .compatible = *compatible,
+                .hash = hash,
+                .module = i,
+            };
+        }
+    }
+
+    int offset;
+    for (offset = fdt_next_node(dtb_blob, -1, NULL); offset >= 0; offset = fdt_next_node(dtb_blob, offset, NULL)) {
+        error = match_node(&state, &io_ops->io_fdt, offset);
+        if (error) {
+            break;
+        }
+    }
+    if (!error && offset != -FDT_ERR_NOTFOUND) {
+        error = offset;
+    }
+
+    ZF_LOGF_IF(ps_free(state.malloc_ops, table_size * sizeof(*state.table), state.table),
+               "Failed to free the driver probe table");
+    ZF_LOGF_IF(ps_free(state.malloc_ops, num_modules * sizeof(*state.last_node), state.last_node),
+               "Failed to free the driver probe state");
+
+    if (!error) {
+        error = dispatch_matches(&state, io_ops, modules);
+    }
+
+    if (state.matches) {
+        ZF_LOGF_IF(ps_free(state.malloc_ops, state.max_matches * sizeof(*state.matches), state.matches),
+                   "Failed to free the driver probe matches");
+    }
+
+    return error;
+}
+
+int ps_driver_modules_probe_all(ps_io_ops_t *io_ops)
+{
+    return ps_driver_modules_probe(io_ops, __start__driver_modules, __stop__driver_modules - __start__driver_modules);
+}
@@ -86,19 +86,17 @@ int ps_fdt_walk_registers(ps_io_fdt_t *io_fdt, ps_fdt_cookie_t *cookie, reg_walk
 
     int node_offset = cookie->node_offset;
 
-    /* NOTE: apparently fdt_parent_offset is expensive to use,
-     * maybe manipulate the path to get the parent's node path instead? */
-    int parent_offset = fdt_parent_offset(dtb_blob, node_offset);
+    int parent_offset = ps_fdt_parent_offset(io_fdt, node_offset);
     if (parent_offset < 0) {
         return parent_offset;
     }
 
     /* get the number of address and size cells */
-    int num_address_cells = fdt_address_cells(dtb_blob, parent_offset);
+    int num_address_cells = ps_fdt_address_cells(io_fdt, parent_offset);
     if (num_address_cells < 0) {
         return num_address_cells;
     }
-    int num_size_cells = fdt_size_cells(dtb_blob, parent_offset);
+    int num_size_cells = ps_fdt_size_cells(io_fdt, parent_offset);
     if (num_size_cells < 0) {
         return num_size_cells;
     }
@@ -109,7 +107,7 @@ int ps_fdt_walk_registers(ps_io_fdt_t *io_fdt, ps_fdt_cookie_t *cookie, reg_walk
     }
 
     int prop_len = 0;
-    const void *reg_prop = fdt_getprop(dtb_blob, node_offset, "reg", &prop_len);
+    const void *reg_prop = ps_fdt_getprop(io_fdt, node_offset, "reg", &prop_len);
     if (!reg_prop) {
         /* The error is written to the variable passed in */
         return prop_len;
@@ -128,6 +126,10 @@ int ps_fdt_walk_registers(ps_io_fdt_t *io_fdt, ps_fdt_cookie_t *cookie, reg_walk
         curr_pmem.type = PMEM_TYPE_DEVICE;
         curr_pmem.base_addr = READ_CELL(num_address_cells, curr, 0);
         curr_pmem.length = READ_CELL(num_size_cells, curr, num_address_cells);
+        uint64_t cpu_addr = 0;
+        if (ps_fdt_translate_address(io_fdt, node_offset, curr_pmem.base_addr, &cpu_addr) == 0) {
+            curr_pmem.base_addr = cpu_addr;
+        }
         int error = callback(curr_pmem, i, num_regs, token);
         if (error) {
             return error;
@@ -164,9 +166,9 @@ int ps_fdt_walk_irqs(ps_io_fdt_t *io_fdt, ps_fdt_cookie_t *cookie, irq_walk_cb_f
     int node_offset = cookie->node_offset;
 
     /* check that this node actually has interrupts */
-    const void *intr_addr = fdt_getprop(dtb_blob, node_offset, "interrupts", NULL);
+    const void *intr_addr = ps_fdt_getprop(io_fdt, node_offset, "interrupts", NULL);
     if (!intr_addr) {
-        intr_addr = fdt_getprop(dtb_blob, node_offset, "interrupts-extended", NULL);
+        intr_addr = ps_fdt_getprop(io_fdt, node_offset, "interrupts-extended", NULL);
         if (!intr_addr) {
             return -FDT_ERR_NOTFOUND;
         }
@@ -177,12 +179,10 @@ int ps_fdt_walk_irqs(ps_io_fdt_t *io_fdt, ps_fdt_cookie_t *cookie, irq_walk_cb_f
     bool found_controller = false;
     const void *intr_parent_prop;
     while (curr_offset >= 0 && !found_controller) {
-        intr_parent_prop = fdt_getprop(dtb_blob, curr_offset, "interrupt-parent", NULL);
+        intr_parent_prop = ps_fdt_getprop(io_fdt, curr_offset, "interrupt-parent", NULL);
         if (!intr_parent_prop) {
-            /* move up a level
-             * NOTE: fdt_parent_offset is apparently expensive to use,
-             * maybe avoid using fdt_parent_offset and manipulate the path instead? */
-            curr_offset = fdt_parent_offset(dtb_blob, curr_offset);
+            /* move up a level */
+            curr_offset = ps_fdt_parent_offset(io_fdt, curr_offset);
         } else {
             found_controller = true;
         }
@@ -203,9 +203,9 @@ int ps_fdt_walk_irqs(ps_io_fdt_t *io_fdt, ps_fdt_cookie_t *cookie, irq_walk_cb_f
         uint32_t intr_controller_phandle = READ_CELL(1, intr_parent_prop, 0);
         ZF_LOGF_IF(intr_controller_phandle == 0,
                    "Failed to get the phandle of the interrupt controller of this node");
-        int intr_controller_offset = fdt_node_offset_by_phandle(dtb_blob, intr_controller_phandle);
+        int intr_controller_offset = ps_fdt_node_offset_by_phandle(io_fdt, intr_controller_phandle);
         ZF_LOGF_IF(intr_controller_offset < 0, "Failed to get the offset of the interrupt controller");
-        intr_parent_prop = fdt_getprop(dtb_blob, intr_controller_offset, "interrupt-parent", NULL);
+        intr_parent_prop = ps_fdt_getprop(io_fdt, intr_controller_offset, "interrupt-parent", NULL);
 
         /* The root interrupt controller node has one of two characteristics:
          *      1. It has a 'interrupt-parent' property that points back to itself
@@ -231,7 +231,8 @@ int ps_fdt_walk_irqs(ps_io_fdt_t *io_fdt, ps_fdt_cookie_t *cookie, irq_walk_cb_f
     }
 
     /* delegate to the interrupt controller specific code */
-    int error = (*irqchip)->parser_fn(dtb_blob, node_offset, root_intr_controller_phandle, callback, token);
+    int error = (*irqchip)->parser_fn(dtb_blob, node_offset, root_intr_controller_phandle,
+                                      root_intr_controller_offset, callback, token);
     if (error) {
         ZF_LOGE("Failed to parse and walk the interrupt field");
         return error;
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2026, agent
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+
+#include <platsupport/fdt.h>
+
+#include "fdt_index.h"
+
+static inline ps_fdt_range_t read_range(const void *prop, int index, int child_cells, int parent_cells,
+                                        int size_cells)
+{
+    const void *curr = prop + index * (child_cells + parent_cells + size_cells) * sizeof(uint32_t);
+    return (ps_fdt_range_t) {
+        .child_addr = READ_CELL(child_cells, curr, 0),
+        .parent_addr = READ_CELL(parent_cells, curr, child_cells),
+        .size = READ_CELL(size_cells, curr, child_cells + parent_cells),
+    };
+}
+
+int fdt_parse_ranges(const void *prop, int prop_len, int child_cells, int parent_cells, int size_cells,
+                     ps_fdt_range_t *entries)
+{
+    if (!prop) {
+        /* The error is written to the length */
+        return prop_len;
+    }
+    if (prop_len == 0) {
+        return 0;
+    }
+
+    if (child_cells < 0) {
+        return child_cells;
+    }
+    if (parent_cells < 0) {
+        return parent_cells;
+    }
+    if (size_cells < 0) {
+        return size_cells;
+    }
+    /* We make the same assumption as READ_CELL, that there are at most 2 cells */
+    if (child_cells > 2 || parent_cells > 2 || size_cells > 2) {
+        return -FDT_ERR_BADNCELLS;
+    }
+
+    int stride = (child_cells + parent_cells + size_cells) * sizeof(uint32_t);
+    if (prop_len % stride != 0) {
+        return -FDT_ERR_BADVALUE;
+    }
+
+    int num_entries = prop_len / stride;
+    if (entries) {
+        for (int i = 0; i < num_entries; i++) {
+            entries[i] = read_range(prop, i, child_cells, parent_cells, size_cells);
+        }
+    }
+
+    return num_entries;
+}
+
+/*
+ * Translate an address of the children of a bus node to the address space of its parent,
+ * using either the parsed entries of the bus node or, if there are none, its property.
+ */
+static int bus_translate(int num_entries, bool dma, const ps_fdt_range_t *entries, const void *prop,
+                         int child_cells, int parent_cells, int size_cells, uint64_t *addr)
+{
+    /* Buses without dma-ranges do not translate DMA addresses, unlike buses without ranges */
+    if (num_entries == -FDT_ERR_NOTFOUND && dma) {
+        return 0;
+    }
+    if (num_entries <= 0) {
+        return num_entries;
+    }
+
+    for (int i = 0; i < num_entries; i++) {
+        ps_fdt_range_t range = entries ? entries[i] : read_range(prop, i, child_cells, parent_cells, size_cells);
+        if (*addr >= range.child_addr && *addr - range.child_addr < range.size) {
+            *addr = *addr - range.child_addr + range.parent_addr;
+            return 0;
+        }
+    }
+
+    return -FDT_ERR_NOTFOUND;
+}
+
+static int translate(ps_io_fdt_t *io_fdt, int node_offset, bool dma, uint64_t addr, uint64_t *ret_addr)
+{
+    if (!ret_addr) {
+        return -EINVAL;
+    }
+
+    char *dtb_blob = ps_io_fdt_get(io_fdt);
+    if (!dtb_blob) {
+        return -EINVAL;
+    }
+
+    /* With an index, the properties of each bus node were parsed once when it was built */
+    const struct ps_fdt_index *index;
+    const ps_fdt_index_node_t *node = fdt_index_lookup(dtb_blob, node_offset, &index);
+    if (node) {
+        /* Like ps_fdt_parent_offset, the root node has no bus to translate through */
+        if (node->parent < 0) {
+            return -FDT_ERR_NOTFOUND;
+        }
+        for (int bus = node->parent; bus >= 0 && index->nodes[bus].parent >= 0; bus = index->nodes[bus].parent) {
+            const ps_fdt_index_ranges_t *ranges = dma ? &index->nodes[bus].dma_ranges : &index->nodes[bus].ranges;
+            int error = bus_translate(ranges->num_entries, dma, &index->range_entries[ranges->first_entry],
+                                      NULL, 0, 0, 0, &addr);
+            if (error) {
+                return error;
+            }
+        }
+
+        *ret_addr = addr;
+        return 0;
+    }
+
+    /* Otherwise parse them on the way up */
+    const char *name = dma ? "dma-ranges" : "ranges";
+    int bus = ps_fdt_parent_offset(io_fdt, node_offset);
+    if (bus < 0) {
+        return bus;
+    }
+    for (int parent = ps_fdt_parent_offset(io_fdt, bus); parent >= 0;
+         bus = parent, parent = ps_fdt_parent_offset(io_fdt, bus)) {
+        int child_cells = ps_fdt_address_cells(io_fdt, bus);
+        int parent_cells = ps_fdt_address_cells(io_fdt, parent);
+        int size_cells = ps_fdt_size_cells(io_fdt, bus);
+        int prop_len = 0;
+        const void *prop = ps_fdt_getprop(io_fdt, bus, name, &prop_len);
+        int num_entries = fdt_parse_ranges(prop, prop_len, child_cells, parent_cells, size_cells, NULL);
+        int error = bus_translate(num_entries, dma, NULL, prop, child_cells, parent_cells, size_cells, &addr);
+        if (error) {
+            return error;
+        }
+    }
+
+    *ret_addr = addr;
+    return 0;
+}
+
+int ps_fdt_translate_address(ps_io_fdt_t *io_fdt, int node_offset, uint64_t bus_addr, uint64_t *ret_addr)
+{
+    return translate(io_fdt, node_offset, false, bus_addr, ret_addr);
+}
+
+int ps_fdt_translate_dma_address(ps_io_fdt_t *io_fdt, int node_offset, uint64_t dma_addr, uint64_t *ret_addr)
+{
+    return translate(io_fdt, node_offset, true, dma_addr, ret_addr);
+}
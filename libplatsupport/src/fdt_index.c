@@ -0,0 +1,393 @@
+/*
+ * Copyright 2026, agent
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <utils/arith.h>
+
+#include <platsupport/fdt.h>
+
+#include "fdt_index.h"
+
+/* The indices by the blob they were built for, newest first */
+static struct ps_fdt_index *fdt_indices;
+
+/* Find the link to the index of a blob, or the NULL link at the end of the list */
+static struct ps_fdt_index **index_link(const void *dtb_blob)
+{
+    struct ps_fdt_index **link = &fdt_indices;
+    while (*link && (*link)->dtb_blob != dtb_blob) {
+        link = &(*link)->next;
+    }
+    return link;
+}
+
+/* Find the slot of a phandle, or the empty slot it would be stored in */
+static ps_fdt_index_phandle_t *phandle_slot(const struct ps_fdt_index *index, uint32_t phandle)
+{
+    uint32_t i = (phandle * 0x9e3779b1u) & index->phandles_mask;
+    while (index->phandles[i].phandle != 0 && index->phandles[i].phandle != phandle) {
+        i = (i + 1) & index->phandles_mask;
+    }
+    return &index->phandles[i];
+}
+
+static void index_ranges(struct ps_fdt_index *index, const char *dtb_blob, const ps_fdt_index_node_t *node,
+                         const char *name, int parent_cells, ps_fdt_index_ranges_t *ranges)
+{
+    int prop_len = 0;
+    const void *prop = fdt_getprop(dtb_blob, node->offset, name, &prop_len);
+    ranges->first_entry = index->num_range_entries;
+    ranges->num_entries = fdt_parse_ranges(prop, prop_len, node->address_cells, parent_cells, node->size_cells,
+                                           &index->range_entries[index->num_range_entries]);
+    if (ranges->num_entries > 0) {
+        index->num_range_entries += ranges->num_entries;
+    }
+}
+
+int ps_fdt_index_init(ps_io_fdt_t *io_fdt, ps_malloc_ops_t *malloc_ops)
+{
+    if (!io_fdt || !malloc_ops) {
+        return -EINVAL;
+    }
+
+    char *dtb_blob = ps_io_fdt_get(io_fdt);
+    if (!dtb_blob) {
+        return -EINVAL;
+    }
+
+    int error = fdt_check_header(dtb_blob);
+    if (error) {
+        return error;
+    }
+
+    int num_nodes = 0;
+    size_t num_phandles = 0;
+    int max_range_entries = 0;
+    int depth = -1;
+    int offset;
+    for (offset = fdt_next_node(dtb_blob, -1, &depth); offset >= 0 && depth >= 0;
+         offset = fdt_next_node(dtb_blob, offset, &depth)) {
+        num_nodes++;
+        if (fdt_get_phandle(dtb_blob, offset) != 0) {
+            num_phandles++;
+        }
+        int prop_len = 0;
+        if (fdt_getprop(dtb_blob, offset, "ranges", &prop_len)) {
+            max_range_entries += fdt_ranges_max_entries(prop_len);
+        }
+        if (fdt_getprop(dtb_blob, offset, "dma-ranges", &prop_len)) {
+            max_range_entries += fdt_ranges_max_entries(prop_len);
+        }
+    }
+    if (offset < 0 && offset != -FDT_ERR_NOTFOUND) {
+        return offset;
+    }
+    if (num_nodes == 0) {
+        return -FDT_ERR_BADSTRUCTURE;
+    }
+
+    /* Keep the phandle table at most half full */
+    size_t phandle_slots = 1;
+    while (phandle_slots < 2 * num_phandles) {
+        phandle_slots *= 2;
+    }
+
+    struct ps_fdt_index *index = NULL;
+    size_t nodes_size = num_nodes * sizeof(index->nodes[0]);
+    size_t ranges_offset = ROUND_UP(sizeof(*index) + nodes_size + phandle_slots * sizeof(index->phandles[0]),
+                                    sizeof(uint64_t));
+    size_t alloc_size = ranges_offset + max_range_entries * sizeof(index->range_entries[0]);
+    error = ps_calloc(malloc_ops, 1, alloc_size, (void **) &index);
+    if (error) {
+        return -ENOMEM;
+    }
+    index->dtb_blob = dtb_blob;
+    index->alloc_size = alloc_size;
+    index->phandles = (void *) &index->nodes[num_nodes];
+    index->phandles_mask = phandle_slots - 1;
+    index->range_entries = (void *)((uintptr_t) index + ranges_offset);
+
+    /* The tree is visited depth first, so the last node added is on the path
+     * from the root to the parent of the next one */
+    int last = -1;
+    depth = -1;
+    for (offset = fdt_next_node(dtb_blob, -1, &depth); offset >= 0 && depth >= 0 && index->num_nodes < num_nodes;
+         offset = fdt_next_node(dtb_blob, offset, &depth)) {
+        int id = index->num_nodes++;
+        ps_fdt_index_node_t *node = &index->nodes[id];
+
+        int prev_sibling = -1;
+        while (last >= 0 && index->nodes[last].depth >= depth) {
+            prev_sibling = last;
+            last = index->nodes[last].parent;
+        }
+
+        *node = (ps_fdt_index_node_t) {
+            .offset = offset,
+            .parent = last,
+            .first_child = -1,
+            .next_sibling = -1,
+            .depth = depth,
+            .address_cells = fdt_address_cells(dtb_blob, offset),
+            .size_cells = fdt_size_cells(dtb_blob, offset),
+        };
+        if (prev_sibling >= 0) {
+            index->nodes[prev_sibling].next_sibling = id;
+        } else if (last >= 0) {
+            index->nodes[last].first_child = id;
+        }
+        last = id;
+
+        /* Parse the translations from the address space of the children to that of the parent */
+        if (node->parent >= 0) {
+            int parent_cells = index->nodes[node->parent].address_cells;
+            index_ranges(index, dtb_blob, node, "ranges", parent_cells, &node->ranges);
+            index_ranges(index, dtb_blob, node, "dma-ranges", parent_cells, &node->dma_ranges);
+        }
+
+        uint32_t phandle = fdt_get_phandle(dtb_blob, offset);
+        if (phandle != 0) {
+            ps_fdt_index_phandle_t *slot = phandle_slot(index, phandle);
+            /* Like fdt_node_offset_by_phandle, the first node with a phandle wins */
+            if (slot->phandle == 0) {
+                *slot = (ps_fdt_index_phandle_t) {
+                    .phandle = phandle,
+                    .offset = offset,
+                };
+            }
+        }
+    }
+
+    /* Replace the previous index of the blob, if there is one */
+    struct ps_fdt_index **link = index_link(dtb_blob);
+    struct ps_fdt_index *previous = *link;
+    if (previous) {
+        index->next = previous->next;
+    }
+    *link = index;
+    if (previous) {
+        ZF_LOGF_IF(ps_free(malloc_ops, previous->alloc_size, previous), "Failed to cleanup the previous FDT index");
+    }
+
+    return 0;
+}
+
+int ps_fdt_index_cleanup(ps_io_fdt_t *io_fdt, ps_malloc_ops_t *malloc_ops)
+{
+    if (!io_fdt || !malloc_ops) {
+        return -EINVAL;
+    }
+
+    char *dtb_blob = ps_io_fdt_get(io_fdt);
+    if (!dtb_blob) {
+        return -EINVAL;
+    }
+
+    struct ps_fdt_index **link = index_link(dtb_blob);
+    struct ps_fdt_index *index = *link;
+    if (!index) {
+        return -EINVAL;
+    }
+    *link = index->next;
+
+    return ps_free(malloc_ops, index->alloc_size, index);
+}
+
+const ps_fdt_index_node_t *fdt_index_lookup(const char *dtb_blob, int node_offset,
+                                            const struct ps_fdt_index **ret_index)
+{
+    const struct ps_fdt_index *index = *index_link(dtb_blob);
+    if (!index) {
+        return NULL;
+    }
+
+    int low = 0;
+    int high = index->num_nodes;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (index->nodes[mid].offset < node_offset) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    if (low == index->num_nodes || index->nodes[low].offset != node_offset) {
+        return NULL;
+    }
+
+    *ret_index = index;
+    return &index->nodes[low];
+}
+
+static inline int index_node_offset(const struct ps_fdt_index *index, int id)
+{
+    return id < 0 ? -FDT_ERR_NOTFOUND : index->nodes[id].offset;
+}
+
+int ps_fdt_parent_offset(ps_io_fdt_t *io_fdt, int node_offset)
+{
+    char *dtb_blob = ps_io_fdt_get(io_fdt);
+    if (!dtb_blob) {
+        return -EINVAL;
+    }
+
+    const struct ps_fdt_index *index;
+    const ps_fdt_index_node_t *node = fdt_index_lookup(dtb_blob, node_offset, &index);
+    if (!node) {
+        return fdt_parent_offset(dtb_blob, node_offset);
+    }
+
+    return index_node_offset(index, node->parent);
+}
+
+int ps_fdt_node_depth(ps_io_fdt_t *io_fdt, int node_offset)
+{
+    char *dtb_blob = ps_io_fdt_get(io_fdt);
+    if (!dtb_blob) {
+        return -EINVAL;
+    }
+
+    const struct ps_fdt_index *index;
+    const ps_fdt_index_node_t *node = fdt_index_lookup(dtb_blob, node_offset, &index);
+    if (!node) {
+        return fdt_node_depth(dtb_blob, node_offset);
+    }
+
+    return node->depth;
+}
+
+int ps_fdt_first_subnode(ps_io_fdt_t *io_fdt, int node_offset)
+{
+    char *dtb_blob = ps_io_fdt_get(io_fdt);
+    if (!dtb_blob) {
+        return -EINVAL;
+    }
+
+    const struct ps_fdt_index *index;
+    const ps_fdt_index_node_t *node = fdt_index_lookup(dtb_blob, node_offset, &index);
+    if (!node) {
+        return fdt_first_subnode(dtb_blob, node_offset);
+    }
+
+    return index_node_offset(index, node->first_child);
+}
+
+int ps_fdt_next_subnode(ps_io_fdt_t *io_fdt, int node_offset)
+{
+    char *dtb_blob = ps_io_fdt_get(io_fdt);
+    if (!dtb_blob) {
+        return -EINVAL;
+    }
+
+    const struct ps_fdt_index *index;
+    const ps_fdt_index_node_t *node = fdt_index_lookup(dtb_blob, node_offset, &index);
+    if (!node) {
+        return fdt_next_subnode(dtb_blob, node_offset);
+    }
+
+    return index_node_offset(index, node->next_sibling);
+}
+
+int ps_fdt_address_cells(ps_io_fdt_t *io_fdt, int node_offset)
+{
+    char *dtb_blob = ps_io_fdt_get(io_fdt);
+    if (!dtb_blob) {
+        return -EINVAL;
+    }
+
+    const struct ps_fdt_index *index;
+    const ps_fdt_index_node_t *node = fdt_index_lookup(dtb_blob, node_offset, &index);
+    if (!node) {
+        return fdt_address_cells(dtb_blob, node_offset);
+    }
+
+    return node->address_cells;
+}
+
+int ps_fdt_size_cells(ps_io_fdt_t *io_fdt, int node_offset)
+{
+    char *dtb_blob = ps_io_fdt_get(io_fdt);
+    if (!dtb_blob) {
+        return -EINVAL;
+    }
+
+    const struct ps_fdt_index *index;
+    const ps_fdt_index_node_t *node = fdt_index_lookup(dtb_blob, node_offset, &index);
+    if (!node) {
+        return fdt_size_cells(dtb_blob, node_offset);
+    }
+
+    return node->size_cells;
+}
+
+int ps_fdt_node_offset_by_phandle(ps_io_fdt_t *io_fdt, uint32_t phandle)
+{
+    char *dtb_blob = ps_io_fdt_get(io_fdt);
+    if (!dtb_blob) {
+        return -EINVAL;
+    }
+
+    const struct ps_fdt_index *index = *index_link(dtb_blob);
+    if (!index) {
+        return fdt_node_offset_by_phandle(dtb_blob, phandle);
+    }
+
+    if (phandle == 0 || phandle == (uint32_t) -1) {
+        return -FDT_ERR_BADPHANDLE;
+    }
+
+    const ps_fdt_index_phandle_t *slot = phandle_slot(index, phandle);
+    if (slot->phandle == 0) {
+        return -FDT_ERR_NOTFOUND;
+    }
+
+    return slot->offset;
+}
+
+int ps_fdt_get_path(ps_io_fdt_t *io_fdt, int node_offset, char *buf, int buflen)
+{
+    char *dtb_blob = ps_io_fdt_get(io_fdt);
+    if (!dtb_blob || !buf) {
+        return -EINVAL;
+    }
+
+    const struct ps_fdt_index *index;
+    const ps_fdt_index_node_t *node = fdt_index_lookup(dtb_blob, node_offset, &index);
+    if (!node) {
+        return fdt_get_path(dtb_blob, node_offset, buf, buflen);
+    }
+
+    /* Walk up to the root once to size the path, then again to fill it in from the end */
+    int len = 0;
+    for (const ps_fdt_index_node_t *curr = node; curr->parent >= 0; curr = &index->nodes[curr->parent]) {
+        int name_len = 0;
+        if (!fdt_get_name(dtb_blob, curr->offset, &name_len)) {
+            return name_len;
+        }
+        len += name_len + 1;
+    }
+    if (len == 0) {
+        len = 1;
+        buf[0] = '/';
+    }
+    if (len >= buflen) {
+        return -FDT_ERR_NOSPACE;
+    }
+
+    buf[len] = '\0';
+    int pos = len;
+    for (const ps_fdt_index_node_t *curr = node; curr->parent >= 0; curr = &index->nodes[curr->parent]) {
+        int name_len = 0;
+        const char *name = fdt_get_name(dtb_blob, curr->offset, &name_len);
+        pos -= name_len;
+        memcpy(buf + pos, name, name_len);
+        buf[--pos] = '/';
+    }
+
+    return 0;
+}
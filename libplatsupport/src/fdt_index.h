@@ -0,0 +1,95 @@
+/*
+ * Copyright 2026, agent
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <platsupport/fdt.h>
+
+/* An entry of a ranges or dma-ranges property */
+typedef struct ps_fdt_range {
+    uint64_t child_addr;
+    uint64_t parent_addr;
+    uint64_t size;
+} ps_fdt_range_t;
+
+/*
+ * The parsed ranges or dma-ranges property of a bus node. num_entries is 0 for
+ * an empty property, which is an identity mapping, or a libfdt error code if
+ * the property is missing or cannot be parsed.
+ */
+typedef struct ps_fdt_index_ranges {
+    int first_entry;
+    int num_entries;
+} ps_fdt_index_ranges_t;
+
+/* Indices of the nodes that a node is linked to, -1 if there is none */
+typedef struct ps_fdt_index_node {
+    int offset;
+    int parent;
+    int first_child;
+    int next_sibling;
+    int depth;
+    /* As returned by fdt_address_cells and fdt_size_cells for this node */
+    int address_cells;
+    int size_cells;
+    ps_fdt_index_ranges_t ranges;
+    ps_fdt_index_ranges_t dma_ranges;
+} ps_fdt_index_node_t;
+
+/* Entry of the phandle table, a phandle of 0 marks an empty slot */
+typedef struct ps_fdt_index_phandle {
+    uint32_t phandle;
+    int offset;
+} ps_fdt_index_phandle_t;
+
+struct ps_fdt_index {
+    /* The blob that was indexed, the index is not used for any other */
+    const void *dtb_blob;
+    /* The index of another blob */
+    struct ps_fdt_index *next;
+    size_t alloc_size;
+    /* Open addressing hash table with a power of two number of slots */
+    ps_fdt_index_phandle_t *phandles;
+    uint32_t phandles_mask;
+    /* Entries of the ranges and dma-ranges properties of all the nodes */
+    ps_fdt_range_t *range_entries;
+    int num_range_entries;
+    int num_nodes;
+    /* In the order of the blob, and thus sorted by offset */
+    ps_fdt_index_node_t nodes[];
+};
+
+/*
+ * Find the indexed node at an offset of a blob.
+ *
+ * @returns The node, NULL if the blob is not indexed
+ */
+const ps_fdt_index_node_t *fdt_index_lookup(const char *dtb_blob, int node_offset,
+                                            const struct ps_fdt_index **ret_index);
+
+/*
+ * Upper bound of the number of entries of a ranges property of a given length.
+ */
+static inline int fdt_ranges_max_entries(int prop_len)
+{
+    /* Every entry has at least one cell for each of its fields */
+    return prop_len > 0 ? prop_len / (3 * sizeof(uint32_t)) : 0;
+}
+
+/*
+ * Parses a ranges or dma-ranges property.
+ *
+ * @param prop The property, NULL if it is missing.
+ * @param prop_len Length of the property, or the error code returned by fdt_getprop.
+ * @param child_cells #address-cells of the bus node.
+ * @param parent_cells #address-cells of the parent of the bus node.
+ * @param size_cells #size-cells of the bus node.
+ * @param entries Storage for the entries, at least fdt_ranges_max_entries(prop_len) of them.
+ *
+ * @returns The number of entries, 0 for an identity mapping, otherwise one of the error codes in libfdt
+ */
+int fdt_parse_ranges(const void *prop, int prop_len, int child_cells, int parent_cells, int size_cells,
+                     ps_fdt_range_t *entries);
@@ -0,0 +1,299 @@
+/*
+ * Copyright 2026, agent
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <platsupport/fdt.h>
+
+/* The trees by the blob they were unflattened from, newest first */
+static ps_fdt_tree_t *fdt_trees;
+
+/* Find the link to the tree of a blob, or the NULL link at the end of the list */
+static ps_fdt_tree_t **tree_link(const void *dtb_blob)
+{
+    ps_fdt_tree_t **link = &fdt_trees;
+    while (*link && (*link)->dtb_blob != dtb_blob) {
+        link = &(*link)->next;
+    }
+    return link;
+}
+
+/* FNV-1a */
+static uint32_t name_hash(const char *name)
+{
+    uint32_t hash = 2166136261u;
+    for (; *name; name++) {
+        hash = (hash ^ (uint8_t) *name) * 16777619u;
+    }
+    return hash;
+}
+
+static inline uint32_t interned_hash(const char *interned_name)
+{
+    return (uint32_t)((uintptr_t) interned_name >> 2) * 0x9e3779b1u;
+}
+
+static inline uint32_t table_slots(uint32_t entries)
+{
+    /* Keep the tables at most half full */
+    uint32_t slots = 1;
+    while (slots < 2 * entries) {
+        slots *= 2;
+    }
+    return slots;
+}
+
+/* Find the slot of a name, or the empty slot it would be interned in */
+static const char **name_slot(const ps_fdt_tree_t *tree, const char *name)
+{
+    uint32_t i = name_hash(name) & tree->names_mask;
+    while (tree->names[i] && strcmp(tree->names[i], name) != 0) {
+        i = (i + 1) & tree->names_mask;
+    }
+    return &tree->names[i];
+}
+
+int ps_fdt_unflatten(ps_io_fdt_t *io_fdt, ps_malloc_ops_t *malloc_ops)
+{
+    if (!io_fdt || !malloc_ops) {
+        return -EINVAL;
+    }
+
+    char *dtb_blob = ps_io_fdt_get(io_fdt);
+    if (!dtb_blob) {
+        return -EINVAL;
+    }
+
+    int error = fdt_check_header(dtb_blob);
+    if (error) {
+        return error;
+    }
+
+    /* Size the arena */
+    int num_nodes = 0;
+    uint32_t num_props = 0;
+    uint32_t num_slots = 0;
+    int offset;
+    for (offset = fdt_next_node(dtb_blob, -1, NULL); offset >= 0; offset = fdt_next_node(dtb_blob, offset, NULL)) {
+        uint32_t node_props = 0;
+        int prop;
+        fdt_for_each_property_offset(prop, dtb_blob, offset) {
+            node_props++;
+        }
+        if (prop != -FDT_ERR_NOTFOUND) {
+            return prop;
+        }
+        num_nodes++;
+        num_props += node_props;
+        num_slots += node_props ? table_slots(node_props) : 0;
+    }
+    if (offset != -FDT_ERR_NOTFOUND) {
+        return offset;
+    }
+    if (num_nodes == 0) {
+        return -FDT_ERR_BADSTRUCTURE;
+    }
+    uint32_t name_slots = table_slots(num_props);
+
+    ps_fdt_tree_t *tree = NULL;
+    size_t alloc_size = sizeof(*tree) + num_nodes * sizeof(tree->nodes[0]) + num_props * sizeof(ps_fdt_prop_t) +
+                        name_slots * sizeof(tree->names[0]) + num_slots * sizeof(uint32_t);
+    error = ps_calloc(malloc_ops, 1, alloc_size, (void **) &tree);
+    if (error) {
+        return -ENOMEM;
+    }
+    tree->dtb_blob = dtb_blob;
+    tree->alloc_size = alloc_size;
+    tree->nodes = (void *)(tree + 1);
+    ps_fdt_prop_t *props = (void *) &tree->nodes[num_nodes];
+    tree->names = (void *) &props[num_props];
+    tree->names_mask = name_slots - 1;
+    uint32_t *slots = (void *) &tree->names[name_slots];
+
+    /* The tree is visited depth first, so the last node added is on the path
+     * from the root to the parent of the next one */
+    ps_fdt_node_t *last = NULL;
+    int depth = -1;
+    int last_depth = -1;
+    for (offset = fdt_next_node(dtb_blob, -1, &depth); offset >= 0 && depth >= 0 && tree->num_nodes < num_nodes;
+         offset = fdt_next_node(dtb_blob, offset, &depth)) {
+        ps_fdt_node_t *node = &tree->nodes[tree->num_nodes++];
+
+        ps_fdt_node_t *prev_sibling = NULL;
+        for (; last && last_depth >= depth; last_depth--) {
+            prev_sibling = last;
+            last = last->parent;
+        }
+
+        node->name = fdt_get_name(dtb_blob, offset, NULL);
+        node->offset = offset;
+        node->parent = last;
+        if (prev_sibling) {
+            prev_sibling->next_sibling = node;
+        } else if (last) {
+            last->first_child = node;
+        }
+        last = node;
+        last_depth = depth;
+
+        node->props = props;
+        int prop;
+        fdt_for_each_property_offset(prop, dtb_blob, offset) {
+            const char *name = NULL;
+            int len = 0;
+            const void *value = fdt_getprop_by_offset(dtb_blob, prop, &name, &len);
+            if (!value) {
+                break;
+            }
+            const char **interned = name_slot(tree, name);
+            if (!*interned) {
+                *interned = name;
+            }
+            node->props[node->num_props++] = (ps_fdt_prop_t) {
+                .name = *interned,
+                .value = value,
+                .len = len,
+            };
+        }
+        props += node->num_props;
+
+        if (node->num_props > 0) {
+            uint32_t node_slots = table_slots(node->num_props);
+            node->prop_table = slots;
+            node->prop_table_mask = node_slots - 1;
+            slots += node_slots;
+            for (uint32_t i = 0; i < node->num_props; i++) {
+                uint32_t slot = interned_hash(node->props[i].name) & node->prop_table_mask;
+                while (node->prop_table[slot] && node->props[node->prop_table[slot] - 1].name != node->props[i].name) {
+                    slot = (slot + 1) & node->prop_table_mask;
+                }
+                /* Like fdt_getprop, the first property with a name wins */
+                if (!node->prop_table[slot]) {
+                    node->prop_table[slot] = i + 1;
+                }
+            }
+        }
+    }
+
+    /* Replace the previous tree of the blob, if there is one */
+    ps_fdt_tree_t **link = tree_link(dtb_blob);
+    ps_fdt_tree_t *previous = *link;
+    if (previous) {
+        tree->next = previous->next;
+    }
+    *link = tree;
+    if (previous) {
+        ZF_LOGF_IF(ps_free(malloc_ops, previous->alloc_size, previous), "Failed to cleanup the previous FDT tree");
+    }
+
+    return 0;
+}
+
+int ps_fdt_unflatten_cleanup(ps_io_fdt_t *io_fdt, ps_malloc_ops_t *malloc_ops)
+{
+    if (!io_fdt || !malloc_ops) {
+        return -EINVAL;
+    }
+
+    char *dtb_blob = ps_io_fdt_get(io_fdt);
+    if (!dtb_blob) {
+        return -EINVAL;
+    }
+
+    ps_fdt_tree_t **link = tree_link(dtb_blob);
+    ps_fdt_tree_t *tree = *link;
+    if (!tree) {
+        return -EINVAL;
+    }
+    *link = tree->next;
+
+    return ps_free(malloc_ops, tree->alloc_size, tree);
+}
+
+const ps_fdt_tree_t *ps_fdt_get_tree(ps_io_fdt_t *io_fdt)
+{
+    char *dtb_blob = ps_io_fdt_get(io_fdt);
+    if (!dtb_blob) {
+        return NULL;
+    }
+
+    return *tree_link(dtb_blob);
+}
+
+const ps_fdt_node_t *ps_fdt_tree_node(const ps_fdt_tree_t *tree, int node_offset)
+{
+    int low = 0;
+    int high = tree->num_nodes;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (tree->nodes[mid].offset < node_offset) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    if (low == tree->num_nodes || tree->nodes[low].offset != node_offset) {
+        return NULL;
+    }
+
+    return &tree->nodes[low];
+}
+
+const char *ps_fdt_tree_intern(const ps_fdt_tree_t *tree, const char *name)
+{
+    return *name_slot(tree, name);
+}
+
+const ps_fdt_prop_t *ps_fdt_node_getprop(const ps_fdt_node_t *node, const char *interned_name)
+{
+    if (node->num_props == 0 || !interned_name) {
+        return NULL;
+    }
+
+    uint32_t slot = interned_hash(interned_name) & node->prop_table_mask;
+    for (; node->prop_table[slot]; slot = (slot + 1) & node->prop_table_mask) {
+        const ps_fdt_prop_t *prop = &node->props[node->prop_table[slot] - 1];
+        if (prop->name == interned_name) {
+            return prop;
+        }
+    }
+
+    return NULL;
+}
+
+const void *ps_fdt_getprop(ps_io_fdt_t *io_fdt, int node_offset, const char *name, int *lenp)
+{
+    char *dtb_blob = ps_io_fdt_get(io_fdt);
+    if (!dtb_blob) {
+        if (lenp) {
+            *lenp = -EINVAL;
+        }
+        return NULL;
+    }
+
+    const ps_fdt_tree_t *tree = *tree_link(dtb_blob);
+    const ps_fdt_node_t *node = NULL;
+    if (tree) {
+        node = ps_fdt_tree_node(tree, node_offset);
+    }
+    if (!node) {
+        return fdt_getprop(dtb_blob, node_offset, name, lenp);
+    }
+
+    const ps_fdt_prop_t *prop = ps_fdt_node_getprop(node, ps_fdt_tree_intern(tree, name));
+    if (!prop) {
+        if (lenp) {
+            *lenp = -FDT_ERR_NOTFOUND;
+        }
+        return NULL;
+    }
+
+    if (lenp) {
+        *lenp = prop->len;
+    }
+    return prop->value;
+}
@@ -30,13 +30,14 @@
  * @param dtb_blob A blob of a platform's FDT.
  * @param node_offset Offset to the device node to be parsed.
  * @param intr_controller_phandle Phandle to the interrupt controller that handles the interrupts of the device.
+ * @param intr_controller_offset Offset to the node of that interrupt controller.
  * @param callback Pointer to a callback function that is called at each interrupt instance in the property.
  * @param token Pointer to a token that is passed into the callback each time it is called.
  *
  * @returns 0 on success, otherwise an error code
  */
 typedef int (*ps_irqchip_parse_fn_t)(char *dtb_blob, int node_offset, int intr_controller_phandle,
-                                     irq_walk_cb_fn_t callback, void *token);
+                                     int intr_controller_offset, irq_walk_cb_fn_t callback, void *token);
 
 /*
  * Struct describing a IRQ parser module.